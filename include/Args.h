@@ -3,10 +3,17 @@
 
 #include <boost/program_options.hpp>
 
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <memory>
+#include <sstream>
 #include <vector>
 
+#include "progress.h"
+#include "threads.h"
+
 namespace CGALApps
 {
 
@@ -15,6 +22,34 @@ class Args
   typedef boost::program_options::options_description Desc;
   Desc all;
   std::vector<Desc> desc;
+  std::string m_batch;
+  std::string m_batch_dir;
+  unsigned int m_jobs;
+  std::string m_cache_dir;
+  bool m_batch_options;
+  std::string m_name;
+  unsigned int m_threads;
+  std::string m_affinity;
+  std::shared_ptr<Thread_control> m_thread_control;
+  bool m_progress;
+  int m_progress_fd;
+
+  // Parsed value of each option as a string, used to identify results
+  std::vector<std::pair<std::string, std::function<std::string()> > > m_values;
+
+  template <typename T>
+  void register_value (const char* tags, const T& var)
+  {
+    std::string name (tags);
+    name = name.substr (0, name.find (','));
+    m_values.push_back (std::make_pair (name, [&var]() -> std::string
+                                        {
+                                          std::ostringstream oss;
+                                          oss.precision (std::numeric_limits<double>::digits10 + 2);
+                                          oss << var;
+                                          return oss.str();
+                                        }));
+  }
 
   template <typename T>
   std::string get_default_str (const T& value, const std::string& default_str)
@@ -33,7 +68,9 @@ class Args
   
 public:
 
-  Args (bool& verbose, std::string& ifilename) : desc(1, Desc("Options"))
+  // Batch processing options are only added if batch_options is true
+  Args (bool& verbose, std::string& ifilename, bool batch_options = true)
+    : desc(1, Desc("Options")), m_jobs(0), m_batch_options(batch_options), m_threads(0), m_progress(false), m_progress_fd(2)
   {
     desc[0].add_options() ("help,h", "Display this help message");
     this->add_option ("verbose,v", "Display info to stderr", verbose, false);
@@ -54,15 +91,40 @@ public:
     desc.back().add_options()(tags,
                               boost::program_options::value<RefType>(&var)->default_value
                               (default_value, get_default_str(default_value, str_default_value)), description);
+    register_value (tags, var);
   }
 
   void add_option (const char* tags, const char* description, bool& var, const bool& default_value)
   {
     desc.back().add_options()(tags, boost::program_options::bool_switch(&var)->default_value(default_value), description);
+    register_value (tags, var);
   }
 
   bool parse(int argc, char** argv)
   {
+    add_section ("Parallelism");
+    add_option ("threads", "Maximum number of threads of parallel algorithms", m_threads, 0, "number of cores");
+    add_option ("affinity", "Pinning of threads to cores: none, compact (fill NUMA nodes one by one) or scatter (spread over NUMA nodes)",
+                m_affinity, "none");
+
+    add_section ("Progress");
+    add_option ("progress", "Display progress lines (fraction done, rate, ETA) of long operations", m_progress, false);
+    add_option ("progress-fd", "File descriptor receiving progress lines", m_progress_fd, 2, "stderr");
+
+    if (m_batch_options)
+    {
+      add_section ("Batch processing");
+      add_option ("batch", "Process several files, given as a text file listing one input per line or as a (quoted) glob pattern",
+                  m_batch, "", "none");
+      add_option ("batch-dir", "Output directory of batch processing", m_batch_dir, "", "none");
+      add_option ("jobs", "Maximum number of files processed concurrently", m_jobs, 0, "number of cores");
+      add_option ("cache-dir", "Directory storing results, reused when an input is processed again with the same options",
+                  m_cache_dir, "", "no cache");
+    }
+
+    m_name = argv[0];
+    m_name = m_name.substr (m_name.find_last_of ('/') + 1);
+
     all.add(desc.back());
     boost::program_options::positional_options_description p;
     p.add("input", -1);
@@ -71,10 +133,40 @@ public:
                                   .options(all).positional(p).run(), vm);
     boost::program_options::notify(vm);
 
+    if (m_affinity != "none" && m_affinity != "compact" && m_affinity != "scatter")
+      throw boost::program_options::invalid_option_value (m_affinity);
+    m_thread_control = std::make_shared<Thread_control> (m_threads, m_affinity);
+
+    if (m_progress)
+      progress_output() = m_progress_fd;
+
     return !vm.count("help");
   }
 
   const boost::program_options::options_description& help() const { return all; }
+
+  const std::string& batch() const { return m_batch; }
+  const std::string& batch_dir() const { return m_batch_dir; }
+  unsigned int jobs() const { return m_jobs; }
+  const std::string& cache_dir() const { return m_cache_dir; }
+  unsigned int threads() const { return m_threads; }
+
+  // Name of the app (as called)
+  const std::string& name() const { return m_name; }
+
+  // Values of the options that change results (not the input/output
+  // files, verbosity, processing and parallelism options)
+  std::string signature() const
+  {
+    std::string out;
+    for (const std::pair<std::string, std::function<std::string()> >& value : m_values)
+      if (value.first != "verbose" && value.first != "input" && value.first != "output"
+          && value.first != "batch" && value.first != "batch-dir" && value.first != "jobs"
+          && value.first != "cache-dir" && value.first != "threads" && value.first != "affinity"
+          && value.first != "progress" && value.first != "progress-fd")
+        out += value.first + "=" + value.second() + ";";
+    return out;
+  }
 };
 
 } // namespace CGALApps
@@ -0,0 +1,103 @@
+#ifndef CGALAPPS_APP_H
+#define CGALAPPS_APP_H
+
+#include <CGAL/Real_timer.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Args.h"
+#include "types.h"
+
+namespace CGALApps
+{
+
+  typedef int (*App_main) (int argc, char** argv);
+
+  struct App
+  {
+    const char* name;
+    App_main main;
+  };
+
+  // Apps linked in the binary (see CGALAPPS_APP)
+  inline std::vector<App>& app_registry()
+  {
+    static std::vector<App> registry;
+    return registry;
+  }
+
+  struct App_registration
+  {
+    App_registration (const char* name, App_main main)
+    {
+      App app = { name, main };
+      app_registry().push_back (app);
+    }
+  };
+
+  // Finds an app by its name, with or without the "cgal_" prefix
+  inline const App* find_app (const std::string& name)
+  {
+    for (const App& app : app_registry())
+      if (name == app.name || "cgal_" + name == app.name)
+        return &app;
+    return nullptr;
+  }
+
+  // Names of the registered apps, sorted
+  inline std::vector<std::string> app_names()
+  {
+    std::vector<std::string> names;
+    for (const App& app : app_registry())
+      names.push_back (app.name);
+    std::sort (names.begin(), names.end());
+    return names;
+  }
+
+  // Help message of an app: banner, description and options
+  inline void print_help (const std::string& title, const std::string& description, const Args& args)
+  {
+    std::string line (title.size() + 11, '-');
+    std::cout << line << std::endl
+              << "[CGALApps] " << title << std::endl
+              << line << std::endl << std::endl
+              << description << std::endl << args.help();
+  }
+
+  // Returns true (and reports the error) if no point was read
+  inline bool empty_input (const Point_set& points)
+  {
+    if (!points.empty())
+      return false;
+    std::cerr << "Error: zero points read." << std::endl;
+    return true;
+  }
+
+  inline void print_done (bool verbose, CGAL::Real_timer& t)
+  {
+    if (!verbose)
+      return;
+    t.stop();
+    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
+  }
+
+} // namespace CGALApps
+
+// Main function of an app. Each app is its own program by default; with
+// CGALAPPS_MULTI_CALL, all apps are linked in the cgalapps binary and
+// registered under their name instead (see src/cgalapps.cpp):
+//   CGALAPPS_APP (cgal_convert) (int argc, char** argv) { ... }
+#ifdef CGALAPPS_MULTI_CALL
+#define CGALAPPS_APP(name)                                              \
+  static int name##_main (int argc, char** argv);                       \
+  static CGALApps::App_registration name##_registration (#name, name##_main); \
+  static int name##_main
+#else
+#define CGALAPPS_APP(name) int main
+#endif
+
+#endif // CGALAPPS_APP_H
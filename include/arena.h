@@ -0,0 +1,210 @@
+#ifndef CGALAPPS_ARENA_H
+#define CGALAPPS_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#ifdef CGAL_LINKED_WITH_TBB
+#include <tbb/enumerable_thread_specific.h>
+#endif
+
+namespace CGALApps
+{
+
+  // Monotonic allocator: memory is taken from large chunks and only
+  // given back all at once, by rewinding to a previous mark. Chunks are
+  // kept when rewinding, so that a thread running many queries with
+  // temporary buffers stops calling malloc after the first ones.
+  // Not thread safe: each thread uses its own arena.
+  class Monotonic_arena
+  {
+    static constexpr std::size_t min_chunk_size = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]> > m_chunks;
+    std::vector<std::size_t> m_chunk_sizes;
+    std::size_t m_chunk = 0;  // Current chunk
+    std::size_t m_offset = 0; // First free byte in the current chunk
+
+    // Counters, see Arena_statistics
+    std::size_t m_nb_allocations = 0;
+    std::size_t m_nb_bytes = 0;
+
+  public:
+
+    struct Mark
+    {
+      std::size_t chunk;
+      std::size_t offset;
+    };
+
+    Monotonic_arena() { }
+    Monotonic_arena (const Monotonic_arena&) { } // Copies are empty arenas
+    Monotonic_arena& operator= (const Monotonic_arena&) = delete;
+
+    void* allocate (std::size_t size, std::size_t alignment)
+    {
+      ++ m_nb_allocations;
+      while (true)
+      {
+        if (m_chunk < m_chunks.size())
+        {
+          std::size_t offset = (m_offset + alignment - 1) / alignment * alignment;
+          if (offset + size <= m_chunk_sizes[m_chunk])
+          {
+            m_offset = offset + size;
+            return m_chunks[m_chunk].get() + offset;
+          }
+          if (m_chunk + 1 < m_chunks.size())
+          {
+            ++ m_chunk;
+            m_offset = 0;
+            continue;
+          }
+        }
+
+        // Chunks grow geometrically, chunk memory is aligned for any type
+        std::size_t chunk_size = (std::max)(size + alignment,
+                                            (std::max)(std::size_t(min_chunk_size), 2 * m_nb_bytes));
+        m_chunks.push_back (std::unique_ptr<char[]> (new char[chunk_size]));
+        m_chunk_sizes.push_back (chunk_size);
+        m_nb_bytes += chunk_size;
+        m_chunk = m_chunks.size() - 1;
+        m_offset = 0;
+      }
+    }
+
+    Mark mark() const { return Mark { m_chunk, m_offset }; }
+
+    // Frees everything allocated since mark was taken
+    void rewind (const Mark& mark)
+    {
+      m_chunk = mark.chunk;
+      m_offset = mark.offset;
+    }
+
+    std::size_t nb_allocations() const { return m_nb_allocations; }
+    std::size_t nb_chunks() const { return m_chunks.size(); }
+    std::size_t nb_bytes() const { return m_nb_bytes; }
+  };
+
+  // Standard allocator on an arena, for containers holding temporary
+  // data. Deallocation is a no-op: memory is reclaimed by rewinding the
+  // arena (see Arena_scope).
+  template <typename T>
+  class Arena_allocator
+  {
+    Monotonic_arena* m_arena;
+
+    template <typename U> friend class Arena_allocator;
+
+  public:
+
+    typedef T value_type;
+
+    Arena_allocator (Monotonic_arena& arena) : m_arena (&arena) { }
+    template <typename U>
+    Arena_allocator (const Arena_allocator<U>& other) : m_arena (other.m_arena) { }
+
+    T* allocate (std::size_t n)
+    {
+      return static_cast<T*>(m_arena->allocate (n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate (T*, std::size_t) { }
+
+    template <typename U>
+    bool operator== (const Arena_allocator<U>& other) const { return m_arena == other.m_arena; }
+    template <typename U>
+    bool operator!= (const Arena_allocator<U>& other) const { return m_arena != other.m_arena; }
+  };
+
+  template <typename T>
+  using Arena_vector = std::vector<T, Arena_allocator<T> >;
+
+  // Everything allocated in the arena during the lifetime of the scope
+  // is freed when it ends
+  class Arena_scope
+  {
+    Monotonic_arena& m_arena;
+    Monotonic_arena::Mark m_mark;
+
+  public:
+
+    Arena_scope (Monotonic_arena& arena)
+      : m_arena (arena), m_mark (arena.mark())
+    { }
+
+    ~Arena_scope()
+    {
+      m_arena.rewind (m_mark);
+    }
+  };
+
+  // One arena per thread
+#ifdef CGAL_LINKED_WITH_TBB
+  typedef tbb::enumerable_thread_specific<Monotonic_arena> Thread_arenas;
+#else
+  class Thread_arenas
+  {
+    Monotonic_arena m_arena;
+
+  public:
+
+    Monotonic_arena& local() { return m_arena; }
+    Monotonic_arena* begin() { return &m_arena; }
+    Monotonic_arena* end() { return &m_arena + 1; }
+  };
+#endif
+
+  // Arenas shared by all per-query temporaries of the program
+  inline Thread_arenas& thread_arenas()
+  {
+    static Thread_arenas arenas;
+    return arenas;
+  }
+
+  inline Monotonic_arena& thread_arena()
+  {
+    return thread_arenas().local();
+  }
+
+  // Allocations served by the arenas, and the heap allocations (chunks)
+  // they required
+  struct Arena_statistics
+  {
+    std::size_t nb_allocations = 0;
+    std::size_t nb_chunks = 0;
+    std::size_t nb_bytes = 0;
+  };
+
+  inline Arena_statistics arena_statistics (Thread_arenas& arenas = thread_arenas())
+  {
+    Arena_statistics out;
+    for (const Monotonic_arena& arena : arenas)
+    {
+      out.nb_allocations += arena.nb_allocations();
+      out.nb_chunks += arena.nb_chunks();
+      out.nb_bytes += arena.nb_bytes();
+    }
+    return out;
+  }
+
+  // Displays the counters, with the number of heap allocations per
+  // query if nb_queries is not 0
+  inline void print_arena_statistics (std::ostream& stream, std::size_t nb_queries = 0,
+                               Thread_arenas& arenas = thread_arenas())
+  {
+    Arena_statistics s = arena_statistics (arenas);
+    stream << s.nb_allocations << " temporary allocation(s) served by "
+           << s.nb_chunks << " heap allocation(s) (" << s.nb_bytes / 1024 << " KiB)";
+    if (nb_queries != 0)
+      stream << ", " << double(s.nb_chunks) / nb_queries << " malloc(s) per query";
+    stream << std::endl;
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_ARENA_H
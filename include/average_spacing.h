@@ -0,0 +1,43 @@
+#ifndef CGALAPPS_AVERAGE_SPACING_H
+#define CGALAPPS_AVERAGE_SPACING_H
+
+#include <cmath>
+#include <vector>
+
+#include "types.h"
+#include "neighbor_search.h"
+#include "parallel.h"
+
+namespace CGALApps
+{
+
+  // Same definition as CGAL::compute_average_spacing(): mean over all
+  // points of the mean distance to their nearest neighbors (the point
+  // itself included)
+  inline double average_spacing (const Point_set& points, const Neighbor_graph& graph)
+  {
+    First_touch_vector<Point_3> local;
+    CGALApps::local_copy (points, points.point_map(), local);
+
+    std::vector<double> spacing (points.size());
+    CGALApps::parallel_for
+      (0, points.size(),
+       [&](std::size_t i)
+       {
+         const Point_3& query = local[i];
+         double sum = 0.;
+         for (const std::size_t* n = graph.neighbors_begin(i); n != graph.neighbors_end(i); ++ n)
+           sum += std::sqrt (CGAL::squared_distance (query, local[*n]));
+         spacing[i] = sum / (graph.neighbors_end(i) - graph.neighbors_begin(i));
+       });
+
+    // Sequential sum, so that the result does not depend on threads
+    double sum = 0.;
+    for (double s : spacing)
+      sum += s;
+    return sum / points.size();
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_AVERAGE_SPACING_H
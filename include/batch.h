@@ -0,0 +1,219 @@
+#ifndef CGALAPPS_BATCH_H
+#define CGALAPPS_BATCH_H
+
+#include <CGAL/Real_timer.h>
+
+#include <boost/filesystem.hpp>
+
+#include <glob.h>
+
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef CGAL_LINKED_WITH_TBB
+#include <tbb/task_group.h>
+#endif
+
+#include "Args.h"
+#include "cache.h"
+#include "parallel.h"
+
+namespace CGALApps
+{
+
+  // Inputs of batch processing: files matching a glob pattern, or
+  // listed one per line in a text file (empty lines and lines
+  // starting with # are ignored)
+  inline bool batch_input_files (const std::string& source, std::vector<std::string>& files)
+  {
+    if (source.find_first_of ("*?[") != std::string::npos)
+    {
+      glob_t matches;
+      if (glob (source.c_str(), 0, nullptr, &matches) == 0)
+        for (std::size_t i = 0; i < matches.gl_pathc; ++ i)
+          files.push_back (matches.gl_pathv[i]);
+      globfree (&matches);
+    }
+    else
+    {
+      std::ifstream f (source.c_str());
+      std::string line;
+      while (std::getline (f, line))
+        if (line != "" && line[0] != '#')
+          files.push_back (line);
+    }
+
+    return !files.empty();
+  }
+
+  // Calls process(input, output) on the files given on the command
+  // line. In batch mode, each input gives an output of the same stem in
+  // the batch directory, with the extension of ofilename if given or
+  // the default extension otherwise. Files are then processed by at
+  // most `--jobs` concurrent tasks: they run in the same TBB arena as
+  // the parallel algorithms they call, so that file-level and
+  // algorithm-level parallelism share the cores instead of
+  // oversubscribing them. Per-file messages are disabled (verbose is
+  // set to false) and a summary is displayed at the end.
+  template <typename Process>
+  int process_files (const Args& args, bool& verbose,
+                     const std::string& ifilename, const std::string& ofilename,
+                     const std::string& extension, const Process& process)
+  {
+    if (args.batch() == "")
+    {
+      int status = EXIT_FAILURE;
+      try
+      {
+        status = process (ifilename, ofilename);
+      }
+      catch (const std::exception& e)
+      {
+        std::cerr << "Error: " << e.what() << std::endl;
+      }
+      if (cancellation_requested())
+      {
+        std::cerr << "Warning: processing was cancelled, the output may be partial." << std::endl;
+        return EXIT_FAILURE;
+      }
+      return status;
+    }
+
+    std::vector<std::string> inputs;
+    if (!batch_input_files (args.batch(), inputs))
+    {
+      std::cerr << "Error: no input file found in " << args.batch() << "." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if (args.batch_dir() == "")
+    {
+      std::cerr << "Error: batch processing requires an output directory." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    boost::filesystem::create_directories (args.batch_dir());
+
+    std::string output_extension = extension;
+    if (ofilename != "")
+      output_extension = boost::filesystem::path(ofilename).extension().string();
+
+    std::vector<std::string> outputs;
+    std::set<std::string> used;
+    for (const std::string& input : inputs)
+    {
+      boost::filesystem::path output (args.batch_dir());
+      output /= boost::filesystem::path(input).stem().string() + output_extension;
+      outputs.push_back (output.string());
+
+      if (!used.insert (outputs.back()).second
+          || (boost::filesystem::exists (output) && boost::filesystem::equivalent (input, output)))
+      {
+        std::cerr << "Error: output " << outputs.back() << " of " << input
+                  << " would overwrite another file of the batch." << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    bool batch_verbose = verbose;
+    verbose = false;
+
+    std::size_t nb_jobs = args.jobs();
+    if (nb_jobs == 0)
+      nb_jobs = nb_threads();
+    nb_jobs = (std::min)(nb_jobs, inputs.size());
+
+    std::vector<int> status (inputs.size(), EXIT_FAILURE);
+    std::vector<double> times (inputs.size(), 0.);
+    std::vector<char> started (inputs.size(), 0);
+    std::atomic<std::size_t> next (0);
+    std::size_t nb_done = 0;
+    std::mutex mutex;
+
+    CGAL::Real_timer t;
+    t.start();
+
+    auto worker = [&]()
+    {
+      // No new file is started once cancellation is requested
+      for (std::size_t i = next ++; i < inputs.size() && !cancellation_requested(); i = next ++)
+      {
+        started[i] = 1;
+        CGAL::Real_timer file_timer;
+        file_timer.start();
+        try
+        {
+          status[i] = process (inputs[i], outputs[i]);
+        }
+        catch (const std::exception& e)
+        {
+          std::lock_guard<std::mutex> lock (mutex);
+          std::cerr << "Error: " << inputs[i] << ": " << e.what() << std::endl;
+        }
+        times[i] = file_timer.time();
+
+        // Output of a cancelled file may be partial
+        if (cancellation_requested())
+          status[i] = EXIT_FAILURE;
+
+        std::lock_guard<std::mutex> lock (mutex);
+        ++ nb_done;
+        if (batch_verbose)
+          std::cerr << "[" << nb_done << "/" << inputs.size() << "] " << inputs[i] << " -> " << outputs[i]
+                    << (status[i] == EXIT_SUCCESS ? "" : " (failed)")
+                    << " in " << times[i] << " second(s)" << std::endl;
+      }
+    };
+
+#ifdef CGAL_LINKED_WITH_TBB
+    tbb::task_group group;
+    for (std::size_t j = 0; j < nb_jobs; ++ j)
+      group.run (worker);
+    group.wait();
+#else
+    worker();
+#endif
+
+    t.stop();
+
+    std::size_t nb_failed = 0;
+    double work = 0.;
+    for (std::size_t i = 0; i < inputs.size(); ++ i)
+    {
+      work += times[i];
+      if (!started[i])
+        continue;
+      if (status[i] != EXIT_SUCCESS)
+      {
+        if (nb_failed == 0)
+          std::cerr << "Failed file(s):" << std::endl;
+        std::cerr << " * " << inputs[i] << std::endl;
+        ++ nb_failed;
+      }
+    }
+
+    std::cerr << nb_done << " file(s) processed in " << t.time() << " second(s)"
+#ifdef CGAL_LINKED_WITH_TBB
+              << " with " << nb_jobs << " job(s)"
+#endif
+              << ", " << nb_failed << " failure(s)"
+              << (cancellation_requested() ? " (cancelled)" : "") << std::endl
+              << " * average time per file = " << work / (std::max)(std::size_t(1), nb_done) << " second(s)" << std::endl;
+    if (t.time() > 0.)
+      std::cerr << " * throughput = " << nb_done / t.time() << " file(s) per second" << std::endl;
+    if (args.cache_dir() != "")
+      std::cerr << " * cache = " << cache_statistics().hits << " hit(s), "
+                << cache_statistics().misses << " miss(es)" << std::endl;
+
+    return (nb_failed == 0 && nb_done == inputs.size() ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_BATCH_H
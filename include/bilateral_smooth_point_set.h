@@ -0,0 +1,107 @@
+#ifndef CGALAPPS_BILATERAL_SMOOTH_POINT_SET_H
+#define CGALAPPS_BILATERAL_SMOOTH_POINT_SET_H
+
+#include <cmath>
+#include <vector>
+
+#include "types.h"
+#include "neighbor_search.h"
+#include "parallel.h"
+
+namespace CGALApps
+{
+
+  // One pass of the bilateral smoothing of CGAL::bilateral_smooth_point_set()
+  // (same weights and neighbor radius guess), but using a precomputed
+  // neighbor graph so that iterations do not rebuild the search tree.
+  // Returns the average squared displacement of the points.
+  inline double bilateral_smooth_point_set (Point_set& points, const Neighbor_graph& graph,
+                                     double sharpness_angle)
+  {
+    const std::size_t size = points.size();
+
+    // Positions and normals of this pass
+    First_touch_vector<Point_3> local_points;
+    First_touch_vector<Vector_3> local_normals;
+    CGALApps::local_copy (points, points.point_map(), local_points);
+    CGALApps::local_copy (points, points.normal_map(), local_normals);
+
+    // Neighbor radius guessed from the farthest neighbors
+    std::vector<double> max_dist (size, 0.);
+    CGALApps::parallel_for
+      (0, size,
+       [&](std::size_t i)
+       {
+         const Point_3& p = local_points[i];
+         for (const std::size_t* n = graph.neighbors_begin(i); n != graph.neighbors_end(i); ++ n)
+           max_dist[i] = (std::max)(max_dist[i], CGAL::squared_distance (p, local_points[*n]));
+       });
+    double radius = 0.;
+    for (std::size_t i = 0; i < size; ++ i)
+      radius = (std::max)(radius, std::sqrt (max_dist[i]));
+    radius *= 0.95;
+
+    const double radius2 = radius * radius;
+    const double iradius16 = -4. / radius2;
+    const double cos_sigma = std::cos (sharpness_angle / 180. * M_PI);
+    const double sharpness_bandwidth = std::pow ((std::max)(1e-8, 1. - cos_sigma), 2);
+
+    First_touch_vector<Point_3> new_points (size);
+    First_touch_vector<Vector_3> new_normals (size);
+
+    CGALApps::parallel_for
+      (0, size,
+       [&](std::size_t i)
+       {
+         const Point_3& query = local_points[i];
+         const Vector_3& normal = local_normals[i];
+
+         double project_dist_sum = 0.;
+         double project_weight_sum = 0.;
+         Vector_3 normal_sum (0., 0., 0.);
+
+         for (const std::size_t* n = graph.neighbors_begin(i); n != graph.neighbors_end(i); ++ n)
+         {
+           const Point_3& np = local_points[*n];
+           const Vector_3& nn = local_normals[*n];
+
+           double dist2 = CGAL::squared_distance (query, np);
+           if (dist2 < radius2)
+           {
+             double theta = std::exp (dist2 * iradius16);
+             double psi = std::exp (-std::pow (1. - normal * nn, 2) / sharpness_bandwidth);
+             double weight = theta * psi;
+
+             project_dist_sum += ((query - np) * nn) * weight;
+             project_weight_sum += weight;
+             normal_sum = normal_sum + nn * weight;
+           }
+         }
+
+         if (project_weight_sum == 0.)
+         {
+           new_points[i] = query;
+           new_normals[i] = normal;
+           return;
+         }
+
+         Vector_3 update_normal = normal_sum / project_weight_sum;
+         new_normals[i] = update_normal / std::sqrt (update_normal.squared_length());
+         new_points[i] = query - normal * (project_dist_sum / project_weight_sum);
+       });
+
+    double sum_displacement = 0.;
+    for (std::size_t i = 0; i < size; ++ i)
+    {
+      typename Point_set::Index idx = *(points.begin() + i);
+      sum_displacement += CGAL::squared_distance (local_points[i], new_points[i]);
+      points.point(idx) = new_points[i];
+      points.normal(idx) = new_normals[i];
+    }
+
+    return sum_displacement / size;
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_BILATERAL_SMOOTH_POINT_SET_H
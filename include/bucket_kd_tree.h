@@ -0,0 +1,274 @@
+#ifndef CGALAPPS_BUCKET_KD_TREE_H
+#define CGALAPPS_BUCKET_KD_TREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+#include "arena.h"
+#include "distance_kernels.h"
+
+namespace CGALApps
+{
+
+  // k-d tree whose leaves (buckets) store the coordinates of their
+  // points as separate x/y/z float arrays, padded to a multiple of 16,
+  // so that leaf scans are a single vectorized distance kernel (see
+  // distance_kernels.h) instead of one call per point through the
+  // search traits. Coordinates are stored relative to the center of
+  // the bounding box to limit the loss of precision of floats.
+  // Neighbors are given as positions in the point set (0 to size-1).
+  class Bucket_kd_tree
+  {
+    static constexpr std::size_t bucket_size = 32;
+    static constexpr float padding = 1e18f; // Far away but finite when squared
+
+    struct Node
+    {
+      float lo[3];
+      float hi[3];
+      std::size_t left = 0;  // 0 for leaves (the root is never a child)
+      std::size_t right = 0;
+      std::size_t begin = 0; // Leaves only: range in the coordinate arrays
+      std::size_t size = 0;
+    };
+
+    double m_origin[3];
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_z;
+    std::vector<std::size_t> m_positions;
+    std::vector<Node> m_nodes;
+    Distance_kernel m_kernel;
+    const char* m_kernel_name;
+
+  public:
+
+    // If simd is false, the scalar kernel is used even if the CPU
+    // supports a wider one
+    Bucket_kd_tree (const Point_set& points, bool simd = true)
+    {
+      std::vector<Point_3> copy;
+      copy.reserve (points.size());
+      for (std::size_t i = 0; i < points.size(); ++ i)
+        copy.push_back (points.point(*(points.begin() + i)));
+      build (copy, simd);
+    }
+
+    Bucket_kd_tree (const std::vector<Point_3>& points, bool simd = true)
+    {
+      build (points, simd);
+    }
+
+    const char* kernel_name() const { return m_kernel_name; }
+
+    // Positions of the points in the order of the leaves: queries run
+    // in this order hit the same leaves consecutively
+    std::vector<std::size_t> spatial_order() const
+    {
+      std::vector<std::size_t> out;
+      out.reserve (m_positions.size());
+      for (std::size_t p : m_positions)
+        if (p != std::size_t(-1))
+          out.push_back (p);
+      return out;
+    }
+
+    // Writes the positions of the k nearest neighbors of query (sorted
+    // by increasing distance, including the query itself if it belongs
+    // to the point set)
+    template <typename OutputIterator>
+    OutputIterator k_neighbors (const Point_3& query, std::size_t k, OutputIterator output) const
+    {
+      if (k == 0 || m_nodes.empty())
+        return output;
+
+      const float q[3] = { float(query.x() - m_origin[0]),
+                           float(query.y() - m_origin[1]),
+                           float(query.z() - m_origin[2]) };
+
+      // The heap is a temporary of the calling thread's arena
+      Monotonic_arena& arena = thread_arena();
+      Arena_scope scope (arena);
+      Arena_vector<std::pair<float, std::size_t> > heap (arena);
+      heap.reserve (k);
+      float worst = std::numeric_limits<float>::infinity();
+      search (0, q, k, heap, worst);
+
+      std::sort_heap (heap.begin(), heap.end());
+      for (const std::pair<float, std::size_t>& h : heap)
+        *(output ++) = h.second;
+      return output;
+    }
+
+  private:
+
+    void build (const std::vector<Point_3>& points, bool simd)
+    {
+      m_kernel = (simd ? best_distance_kernel (&m_kernel_name) : scalar_distance_kernel);
+      if (!simd)
+        m_kernel_name = "scalar";
+
+      if (points.empty())
+        return;
+
+      double lo[3] = { points[0].x(), points[0].y(), points[0].z() };
+      double hi[3] = { lo[0], lo[1], lo[2] };
+      for (const Point_3& p : points)
+        for (int j = 0; j < 3; ++ j)
+        {
+          lo[j] = (std::min)(lo[j], p[j]);
+          hi[j] = (std::max)(hi[j], p[j]);
+        }
+      for (int j = 0; j < 3; ++ j)
+        m_origin[j] = 0.5 * (lo[j] + hi[j]);
+
+      std::vector<float> coords (3 * points.size());
+      for (std::size_t i = 0; i < points.size(); ++ i)
+        for (int j = 0; j < 3; ++ j)
+          coords[3 * i + j] = float(points[i][j] - m_origin[j]);
+
+      std::vector<std::size_t> order (points.size());
+      for (std::size_t i = 0; i < order.size(); ++ i)
+        order[i] = i;
+
+      m_nodes.reserve (2 * (points.size() / (bucket_size / 2) + 1));
+      std::size_t padded_size = points.size() + 16 * (points.size() / (bucket_size / 2) + 1);
+      m_x.reserve (padded_size);
+      m_y.reserve (padded_size);
+      m_z.reserve (padded_size);
+      m_positions.reserve (padded_size);
+
+      build_node (coords, order, 0, order.size());
+    }
+
+    std::size_t build_node (const std::vector<float>& coords, std::vector<std::size_t>& order,
+                            std::size_t begin, std::size_t end)
+    {
+      std::size_t index = m_nodes.size();
+      m_nodes.push_back (Node());
+
+      Node node;
+      for (int j = 0; j < 3; ++ j)
+      {
+        node.lo[j] = std::numeric_limits<float>::max();
+        node.hi[j] = -std::numeric_limits<float>::max();
+      }
+      for (std::size_t i = begin; i < end; ++ i)
+        for (int j = 0; j < 3; ++ j)
+        {
+          node.lo[j] = (std::min)(node.lo[j], coords[3 * order[i] + j]);
+          node.hi[j] = (std::max)(node.hi[j], coords[3 * order[i] + j]);
+        }
+
+      if (end - begin <= bucket_size)
+      {
+        node.begin = m_x.size();
+        node.size = end - begin;
+        for (std::size_t i = begin; i < end; ++ i)
+        {
+          m_x.push_back (coords[3 * order[i]]);
+          m_y.push_back (coords[3 * order[i] + 1]);
+          m_z.push_back (coords[3 * order[i] + 2]);
+          m_positions.push_back (order[i]);
+        }
+        while ((m_x.size() - node.begin) % 16 != 0)
+        {
+          m_x.push_back (float(padding));
+          m_y.push_back (float(padding));
+          m_z.push_back (float(padding));
+          m_positions.push_back (std::size_t(-1));
+        }
+        m_nodes[index] = node;
+        return index;
+      }
+
+      int axis = 0;
+      for (int j = 1; j < 3; ++ j)
+        if (node.hi[j] - node.lo[j] > node.hi[axis] - node.lo[axis])
+          axis = j;
+
+      std::size_t middle = (begin + end) / 2;
+      std::nth_element (order.begin() + begin, order.begin() + middle, order.begin() + end,
+                        [&](std::size_t a, std::size_t b) -> bool
+                        {
+                          return coords[3 * a + axis] < coords[3 * b + axis];
+                        });
+
+      node.left = build_node (coords, order, begin, middle);
+      node.right = build_node (coords, order, middle, end);
+      m_nodes[index] = node;
+      return index;
+    }
+
+    float box_squared_distance (const Node& node, const float q[3]) const
+    {
+      float out = 0.f;
+      for (int j = 0; j < 3; ++ j)
+      {
+        float d = (std::max)(0.f, (std::max)(node.lo[j] - q[j], q[j] - node.hi[j]));
+        out += d * d;
+      }
+      return out;
+    }
+
+    void search (std::size_t index, const float q[3], std::size_t k,
+                 Arena_vector<std::pair<float, std::size_t> >& heap, float& worst) const
+    {
+      const Node& node = m_nodes[index];
+
+      if (node.left == 0)
+      {
+        float d[bucket_size + 16];
+        std::size_t padded = (node.size + 15) & ~std::size_t(15);
+        std::uint64_t mask = m_kernel (m_x.data() + node.begin, m_y.data() + node.begin, m_z.data() + node.begin,
+                                       padded, q, worst, d);
+        // Padding points are far but closer than an infinite threshold
+        mask &= (node.size == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << node.size) - 1);
+
+        for (std::size_t i = 0; mask != 0; ++ i, mask >>= 1)
+        {
+          if (!(mask & 1))
+            continue;
+          if (heap.size() < k)
+          {
+            heap.push_back (std::make_pair (d[i], m_positions[node.begin + i]));
+            std::push_heap (heap.begin(), heap.end());
+            if (heap.size() == k)
+              worst = heap.front().first;
+          }
+          else if (d[i] < worst)
+          {
+            std::pop_heap (heap.begin(), heap.end());
+            heap.back() = std::make_pair (d[i], m_positions[node.begin + i]);
+            std::push_heap (heap.begin(), heap.end());
+            worst = heap.front().first;
+          }
+        }
+        return;
+      }
+
+      // Closest child first, so that the second one is more likely to
+      // be pruned
+      float d_left = box_squared_distance (m_nodes[node.left], q);
+      float d_right = box_squared_distance (m_nodes[node.right], q);
+      std::size_t first = node.left, second = node.right;
+      if (d_right < d_left)
+      {
+        std::swap (first, second);
+        std::swap (d_left, d_right);
+      }
+
+      if (d_left < worst)
+        search (first, q, k, heap, worst);
+      if (d_right < worst)
+        search (second, q, k, heap, worst);
+    }
+  };
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_BUCKET_KD_TREE_H
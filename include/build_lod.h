@@ -0,0 +1,182 @@
+#ifndef CGALAPPS_BUILD_LOD_H
+#define CGALAPPS_BUILD_LOD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "parallel.h"
+
+namespace CGALApps
+{
+
+  // Node of the LOD octree: after build_lod(), the points of a node are
+  // the range [begin;end) of the reordered point set
+  struct LOD_node
+  {
+    std::string name; // "r" followed by one octant digit per level
+    unsigned int depth;
+    std::size_t begin;
+    std::size_t end;
+  };
+
+  inline std::uint64_t lod_spread_bits (std::uint64_t v)
+  {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8) & 0x100f00f00f00f00full;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+  }
+
+  // Octant digit is (x << 2 | y << 1 | z) at each level
+  inline std::uint64_t lod_morton_key (std::uint64_t x, std::uint64_t y, std::uint64_t z)
+  {
+    return (lod_spread_bits(x) << 2) | (lod_spread_bits(y) << 1) | lod_spread_bits(z);
+  }
+
+  // Builds an octree of depth max_depth in which each node holds a
+  // representative subsample of its cell (one point per cell of a grid
+  // of 2^resolution cells per axis, closest to the grid cell center)
+  // and passes the other points to its children. The leaves keep all
+  // remaining points, so each input point belongs to exactly one node.
+  //
+  // The point set is reordered coarse-to-fine: nodes are sorted by
+  // depth, then by Morton order.
+  inline void build_lod (Point_set& points, unsigned int max_depth, unsigned int resolution,
+                  std::vector<LOD_node>& nodes)
+  {
+    const std::size_t size = points.size();
+    const unsigned int grid_depth = max_depth + resolution;
+
+    // Bounding cube
+    double min[3] = { std::numeric_limits<double>::max(),
+                      std::numeric_limits<double>::max(),
+                      std::numeric_limits<double>::max() };
+    double max[3] = { -std::numeric_limits<double>::max(),
+                      -std::numeric_limits<double>::max(),
+                      -std::numeric_limits<double>::max() };
+    for (typename Point_set::iterator it = points.begin(); it != points.end(); ++ it)
+    {
+      const Point_3& p = points.point(*it);
+      for (int j = 0; j < 3; ++ j)
+      {
+        min[j] = (std::min)(min[j], p[j]);
+        max[j] = (std::max)(max[j], p[j]);
+      }
+    }
+    double cube_size = (std::max)((std::max)(max[0] - min[0], max[1] - min[1]), max[2] - min[2]);
+    if (cube_size == 0.)
+      cube_size = 1.;
+    cube_size *= 1.0001; // Make sure the maximum coordinates fall inside the cube
+
+    const std::uint64_t nb_cells = (std::uint64_t(1) << grid_depth);
+    const double cell_size = cube_size / nb_cells;
+
+    // Morton keys on the finest grid, computed in parallel
+    std::vector<std::pair<std::uint64_t, std::size_t> > keys (size);
+    CGALApps::parallel_for
+      (0, size,
+       [&](std::size_t i)
+       {
+         const Point_3& p = points.point(*(points.begin() + i));
+         std::uint64_t coord[3];
+         for (int j = 0; j < 3; ++ j)
+           coord[j] = (std::min)(std::uint64_t((p[j] - min[j]) / cell_size), nb_cells - 1);
+         keys[i] = std::make_pair (lod_morton_key (coord[0], coord[1], coord[2]), i);
+       });
+    CGALApps::parallel_sort (keys.begin(), keys.end());
+
+    // Level of each point in sorted order, leaves by default
+    std::vector<unsigned int> level (size, max_depth);
+
+    for (unsigned int depth = 0; depth < max_depth; ++ depth)
+    {
+      // Nodes of this depth are contiguous ranges of the sorted keys
+      const unsigned int node_shift = 3 * (grid_depth - depth);
+      std::vector<std::size_t> node_begins;
+      for (std::size_t i = 0; i < size; ++ i)
+        if (i == 0 || (keys[i].first >> node_shift) != (keys[i-1].first >> node_shift))
+          node_begins.push_back (i);
+      node_begins.push_back (size);
+
+      // Subsample grid of this depth
+      const unsigned int sub_shift = 3 * (grid_depth - depth - resolution);
+      const double sub_size = cell_size * double(std::uint64_t(1) << (grid_depth - depth - resolution));
+
+      CGALApps::parallel_for
+        (0, node_begins.size() - 1,
+         [&](std::size_t n)
+         {
+           std::size_t selected = size;
+           double selected_dist = 0.;
+           for (std::size_t i = node_begins[n]; i < node_begins[n+1]; ++ i)
+           {
+             if (level[i] == max_depth) // Not yet selected by a coarser node
+             {
+               const Point_3& p = points.point(*(points.begin() + keys[i].second));
+               double dist = 0.;
+               for (int j = 0; j < 3; ++ j)
+               {
+                 double center = min[j] + sub_size * (std::floor ((p[j] - min[j]) / sub_size) + 0.5);
+                 dist += (p[j] - center) * (p[j] - center);
+               }
+               if (selected == size || dist < selected_dist)
+               {
+                 selected = i;
+                 selected_dist = dist;
+               }
+             }
+
+             if (i + 1 == node_begins[n+1] || (keys[i].first >> sub_shift) != (keys[i+1].first >> sub_shift))
+             {
+               if (selected != size)
+                 level[selected] = depth;
+               selected = size;
+             }
+           }
+         });
+    }
+
+    // Sort coarse-to-fine: depth first, then Morton order of the node
+    std::vector<std::size_t> order (size);
+    for (std::size_t i = 0; i < size; ++ i)
+      order[i] = i;
+    CGALApps::parallel_sort (order.begin(), order.end(),
+                             [&](const std::size_t& a, const std::size_t& b) -> bool
+                             {
+                               if (level[a] != level[b])
+                                 return level[a] < level[b];
+                               return keys[a].first < keys[b].first;
+                             });
+
+    nodes.clear();
+    for (std::size_t i = 0; i < size; ++ i)
+    {
+      unsigned int depth = level[order[i]];
+      std::uint64_t node_key = keys[order[i]].first >> (3 * (grid_depth - depth));
+      if (i == 0 || nodes.back().depth != depth
+          || node_key != (keys[order[i-1]].first >> (3 * (grid_depth - depth))))
+      {
+        LOD_node node;
+        node.name = "r";
+        for (unsigned int d = depth; d > 0; -- d)
+          node.name += char('0' + ((node_key >> (3 * (d - 1))) & 7));
+        node.depth = depth;
+        node.begin = i;
+        nodes.push_back (node);
+      }
+      nodes.back().end = i + 1;
+    }
+
+    std::vector<typename Point_set::Index> indices (points.begin(), points.end());
+    for (std::size_t i = 0; i < size; ++ i)
+      *(points.begin() + i) = indices[keys[order[i]].second];
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_BUILD_LOD_H
@@ -0,0 +1,205 @@
+#ifndef CGALAPPS_CACHE_H
+#define CGALAPPS_CACHE_H
+
+#include <boost/filesystem.hpp>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+#include "Args.h"
+#include "hash.h"
+#include "io.h"
+#include "types.h"
+
+namespace CGALApps
+{
+
+  struct Cache_statistics
+  {
+    std::atomic<std::size_t> hits;
+    std::atomic<std::size_t> misses;
+
+    Cache_statistics() : hits (0), misses (0) { }
+  };
+
+  inline Cache_statistics& cache_statistics()
+  {
+    static Cache_statistics statistics;
+    return statistics;
+  }
+
+  // Output stream buffer writing to two stream buffers
+  class Tee_streambuf : public std::streambuf
+  {
+    std::streambuf* m_first;
+    std::streambuf* m_second;
+
+  public:
+
+    Tee_streambuf (std::streambuf* first, std::streambuf* second)
+      : m_first (first), m_second (second)
+    { }
+
+  protected:
+
+    int_type overflow (int_type c)
+    {
+      if (traits_type::eq_int_type (c, traits_type::eof()))
+        return traits_type::not_eof (c);
+      if (traits_type::eq_int_type (m_first->sputc (traits_type::to_char_type (c)), traits_type::eof())
+          || traits_type::eq_int_type (m_second->sputc (traits_type::to_char_type (c)), traits_type::eof()))
+        return traits_type::eof();
+      return c;
+    }
+
+    std::streamsize xsputn (const char* s, std::streamsize n)
+    {
+      std::streamsize written = m_first->sputn (s, n);
+      m_second->sputn (s, written);
+      return written;
+    }
+
+    int sync()
+    {
+      int first = m_first->pubsync();
+      int second = m_second->pubsync();
+      return (first == 0 && second == 0 ? 0 : -1);
+    }
+  };
+
+  // Content-addressed store of results. The key of a result is the
+  // hash of the input bytes (computed while reading), of the name of
+  // the app, of the values of its options and of the output
+  // extension. Entries are written to a temporary file then renamed,
+  // so that concurrent processes never see partial results.
+  class Result_cache
+  {
+    std::string m_dir;
+    std::string m_prefix;
+    bool m_verbose;
+    std::string m_entry;
+    std::string m_temporary;
+
+    // Copy of stdout when the result is written there
+    std::ofstream m_stdout_copy;
+    std::unique_ptr<Tee_streambuf> m_tee;
+    std::streambuf* m_stdout_buffer;
+
+  public:
+
+    Result_cache (const Args& args, bool verbose)
+      : m_dir (args.cache_dir()), m_prefix (args.name() + "\n" + args.signature())
+      , m_verbose (verbose), m_stdout_buffer (nullptr)
+    { }
+
+    ~Result_cache()
+    {
+      // Result not stored (failure)
+      restore_stdout();
+      if (m_temporary != "")
+        boost::filesystem::remove (m_temporary);
+    }
+
+    bool enabled() const { return m_dir != ""; }
+
+    // Reads the input point set. If the cache is enabled and already
+    // has the result for this input, the result is copied to ofilename
+    // (or stdout) and true is returned.
+    bool read_point_set (const std::string& ifilename, Point_set& points, const std::string& ofilename)
+    {
+      if (!enabled())
+      {
+        CGALApps::read_point_set (ifilename, points);
+        return false;
+      }
+
+      std::uint64_t input_hash = CGALApps::read_point_set_and_hash (ifilename, points);
+
+      std::string extension = boost::filesystem::path(ofilename).extension().string();
+      Hash_64 key;
+      key.add (&input_hash, sizeof(std::uint64_t));
+      key.add (m_prefix);
+      key.add (extension);
+
+      boost::filesystem::create_directories (m_dir);
+      m_entry = (boost::filesystem::path(m_dir) / (hash_to_string (key.digest()) + extension)).string();
+
+      if (boost::filesystem::exists (m_entry))
+      {
+        ++ cache_statistics().hits;
+        if (m_verbose)
+          std::cerr << "Result found in cache (" << m_entry << ")." << std::endl;
+
+        std::ifstream entry (m_entry.c_str(), std::ios::binary);
+        if (ofilename == "")
+          std::cout << entry.rdbuf();
+        else
+        {
+          std::ofstream output (ofilename.c_str(), std::ios::binary);
+          output << entry.rdbuf();
+        }
+        m_entry = "";
+        return true;
+      }
+
+      ++ cache_statistics().misses;
+
+      static std::atomic<std::size_t> nb_temporaries (0);
+      std::ostringstream temporary;
+      temporary << m_entry << "." << getpid() << "." << (nb_temporaries ++) << ".tmp";
+      m_temporary = temporary.str();
+
+      if (ofilename == "")
+      {
+        m_stdout_copy.open (m_temporary.c_str(), std::ios::binary);
+        m_tee.reset (new Tee_streambuf (std::cout.rdbuf(), m_stdout_copy.rdbuf()));
+        m_stdout_buffer = std::cout.rdbuf (m_tee.get());
+      }
+
+      return false;
+    }
+
+    // Stores the result that was written to ofilename (or stdout)
+    void store (const std::string& ofilename)
+    {
+      // Results of cancelled runs may be partial
+      if (!enabled() || m_entry == "" || cancellation_requested())
+        return;
+
+      if (ofilename == "")
+      {
+        restore_stdout();
+        m_stdout_copy.close();
+      }
+      else
+        boost::filesystem::copy_file (ofilename, m_temporary,
+                                      boost::filesystem::copy_option::overwrite_if_exists);
+
+      boost::filesystem::rename (m_temporary, m_entry);
+      m_temporary = "";
+      m_entry = "";
+    }
+
+  private:
+
+    void restore_stdout()
+    {
+      if (m_stdout_buffer == nullptr)
+        return;
+      std::cout.flush();
+      std::cout.rdbuf (m_stdout_buffer);
+      m_stdout_buffer = nullptr;
+    }
+  };
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_CACHE_H
@@ -6,12 +6,75 @@
 #include <CGAL/Orthogonal_k_neighbor_search.h>
 #include <CGAL/Fuzzy_sphere.h>
 
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
 #include "types.h"
+#include "arena.h"
+#include "covariance.h"
+#include "neighbor_search.h"
+#include "parallel.h"
 
 namespace CGALApps
 {
 
-  void cluster_point_set (Point_set& points, double cluster_tolerance, std::size_t min_points, int method)
+  typedef std::vector<typename Point_set::Index> Point_cluster;
+
+  // Statistics of a cluster, accumulated while the cluster grows
+  // (running mean and co-moment, so that no pass over the points is
+  // needed afterwards). The oriented box is only computed by
+  // compute_oriented_boxes().
+  struct Cluster_statistics
+  {
+    std::size_t count = 0;
+    double min[3];
+    double max[3];
+    double mean[3] = { 0., 0., 0. };
+    double comoment[6] = { 0., 0., 0., 0., 0., 0. }; // Same layout as covariance.h
+
+    double obb_center[3];
+    double obb_axes[9];    // Principal axes, by ascending variance
+    double obb_extents[3]; // Half sizes along the axes
+
+    void add (const Point_3& p)
+    {
+      const double c[3] = { p.x(), p.y(), p.z() };
+      ++ count;
+
+      double before[3], after[3];
+      for (int j = 0; j < 3; ++ j)
+      {
+        min[j] = (count == 1 ? c[j] : (std::min)(min[j], c[j]));
+        max[j] = (count == 1 ? c[j] : (std::max)(max[j], c[j]));
+        before[j] = c[j] - mean[j];
+        mean[j] += before[j] / count;
+        after[j] = c[j] - mean[j];
+      }
+
+      comoment[0] += before[0] * after[0];
+      comoment[1] += before[0] * after[1];
+      comoment[2] += before[0] * after[2];
+      comoment[3] += before[1] * after[1];
+      comoment[4] += before[1] * after[2];
+      comoment[5] += before[2] * after[2];
+    }
+
+    void covariance (double cov[6]) const
+    {
+      for (int i = 0; i < 6; ++ i)
+        cov[i] = comoment[i] / count;
+    }
+  };
+
+  // Single-linkage clustering: points closer than cluster_tolerance
+  // are in the same cluster. Clusters smaller than min_points are
+  // dropped.
+  inline void cluster_point_set (const Point_set& points, double cluster_tolerance, std::size_t min_points,
+                          std::vector<Point_cluster>& clusters,
+                          std::vector<Cluster_statistics>& statistics)
   {
     typedef CGAL::Search_traits_3<Kernel> Traits_base;
     typedef CGAL::Search_traits_adapter<typename Point_set::Index,
@@ -23,52 +86,227 @@ namespace CGALApps
     typedef Tree::Splitter Splitter;
     typedef CGAL::Fuzzy_sphere<Tree_traits> Sphere;
 
-    typedef std::vector<typename Point_set::Index> Cluster;
-
     Tree_traits traits (points.point_map());
     Tree tree (points.begin(), points.end(), Splitter(), traits);
-    
-    std::vector<Cluster> clusters;
-    std::set<typename Point_set::Index> done;
-    
-    std::size_t max_size = 0;
-    std::size_t max_index = 0;
-    for (typename Point_set::iterator it = points.begin(); it != points.end(); ++ it)
+
+    std::vector<std::size_t> position;
+    point_positions (points, position);
+    std::vector<char> done (points.size(), 0);
+
+    // Sphere queries write into a buffer of the arena, reused by all
+    // queries, and only points not yet reached are queued
+    Monotonic_arena& arena = thread_arena();
+    std::deque<typename Point_set::Index> todo;
+
+    for (typename Point_set::const_iterator it = points.begin(); it != points.end(); ++ it)
     {
-      clusters.push_back (Cluster());
+      if (done[position[std::size_t(*it)]])
+        continue;
+
+      clusters.push_back (Point_cluster());
+      statistics.push_back (Cluster_statistics());
 
-      std::deque<typename Point_set::Index> todo;
+      done[position[std::size_t(*it)]] = 1;
       todo.push_back (*it);
-      
+
       while (!(todo.empty()))
       {
         typename Point_set::Index current = todo.front();
         todo.pop_front();
-        if (!(done.insert (current).second))
-          continue;
         clusters.back().push_back (current);
-          
+        statistics.back().add (points.point(current));
+
+        Arena_scope scope (arena);
+        Arena_vector<typename Point_set::Index> found (arena);
         Sphere s(points.point(current), cluster_tolerance, 0., traits);
-        tree.search (std::back_inserter (todo), s);
+        tree.search (std::back_inserter (found), s);
+
+        for (const typename Point_set::Index& f : found)
+          if (!done[position[std::size_t(f)]])
+          {
+            done[position[std::size_t(f)]] = 1;
+            todo.push_back (f);
+          }
       }
-      if (clusters.back().empty())
+
+      if (clusters.back().size() < min_points || clusters.back().empty())
       {
         clusters.pop_back();
-        continue;
+        statistics.pop_back();
       }
-      
-      if (clusters.back().size() >= min_points)
+    }
+  }
+
+  // Density-based clustering (DBSCAN): points with at least
+  // min_neighbors points (including themselves) at distance at most
+  // epsilon are core points. Clusters are the connected components of
+  // core points, plus the non-core points in the neighborhood of a
+  // core point (border points). Other points are noise, which
+  // removes outliers in the same neighborhood pass as clustering.
+  inline void dbscan_cluster_point_set (const Point_set& points, double epsilon, std::size_t min_neighbors,
+                                 std::size_t min_points, std::vector<Point_cluster>& clusters,
+                                 std::vector<Cluster_statistics>& statistics)
+  {
+    std::vector<std::size_t> position;
+    point_positions (points, position);
+
+    // Neighbors are only kept for core points, the only ones expanded.
+    // They are stored in per-thread arenas freed at the end of the
+    // function (no allocation per point), the query buffer being a
+    // temporary of the thread's arena.
+    Thread_arenas storage;
+    std::vector<std::pair<const std::size_t*, std::size_t> > core_neighbors (points.size());
+    std::vector<char> core (points.size(), 0);
+
+    Neighbor_query query (points);
+    CGALApps::parallel_for
+      (0, points.size(),
+       [&](std::size_t i)
+       {
+         Monotonic_arena& arena = thread_arena();
+         Arena_scope scope (arena);
+         Arena_vector<typename Point_set::Index> neighbors (arena);
+         query.neighbors_in_radius (points.point(*(points.begin() + i)), epsilon,
+                                    std::back_inserter (neighbors));
+         if (neighbors.size() < min_neighbors)
+           return;
+
+         core[i] = 1;
+         std::size_t* out = Arena_allocator<std::size_t> (storage.local()).allocate (neighbors.size());
+         for (std::size_t j = 0; j < neighbors.size(); ++ j)
+           out[j] = position[std::size_t(neighbors[j])];
+         core_neighbors[i] = std::make_pair (out, neighbors.size());
+       });
+
+    std::vector<int> cluster_of (points.size(), -1);
+    std::vector<std::size_t> todo;
+
+    int nb_clusters = 0;
+    for (std::size_t i = 0; i < points.size(); ++ i)
+    {
+      if (!core[i] || cluster_of[i] != -1)
+        continue;
+
+      int current_cluster = nb_clusters ++;
+      clusters.push_back (Point_cluster());
+      statistics.push_back (Cluster_statistics());
+
+      cluster_of[i] = current_cluster;
+      todo.push_back (i);
+      while (!todo.empty())
       {
-        if (clusters.back().size() > max_size)
+        std::size_t current = todo.back();
+        todo.pop_back();
+        clusters.back().push_back (*(points.begin() + current));
+        statistics.back().add (points.point(*(points.begin() + current)));
+
+        // Border points belong to the cluster but are not expanded
+        if (!core[current])
+          continue;
+
+        for (std::size_t j = 0; j < core_neighbors[current].second; ++ j)
         {
-          max_size = clusters.back().size();
-          max_index = clusters.size() - 1;
+          std::size_t n = core_neighbors[current].first[j];
+          if (cluster_of[n] == -1)
+          {
+            cluster_of[n] = current_cluster;
+            todo.push_back (n);
+          }
         }
       }
-      else
+
+      if (clusters.back().size() < min_points)
+      {
         clusters.pop_back();
+        statistics.pop_back();
+      }
+    }
+  }
+
+  // Oriented bounding boxes along the principal axes of the clusters,
+  // computed in parallel over clusters
+  inline void compute_oriented_boxes (const Point_set& points, const std::vector<Point_cluster>& clusters,
+                               std::vector<Cluster_statistics>& statistics)
+  {
+    CGALApps::parallel_for
+      (0, clusters.size(),
+       [&](std::size_t c)
+       {
+         Cluster_statistics& s = statistics[c];
+
+         double cov[6];
+         double values[3];
+         s.covariance (cov);
+         symmetric_eigen_3 (cov, values, s.obb_axes);
+
+         double lo[3], hi[3];
+         for (int a = 0; a < 3; ++ a)
+         {
+           lo[a] = std::numeric_limits<double>::max();
+           hi[a] = -std::numeric_limits<double>::max();
+         }
+
+         for (const typename Point_set::Index& idx : clusters[c])
+         {
+           const Point_3& p = points.point(idx);
+           const double d[3] = { p.x() - s.mean[0], p.y() - s.mean[1], p.z() - s.mean[2] };
+           for (int a = 0; a < 3; ++ a)
+           {
+             double proj = d[0] * s.obb_axes[3*a] + d[1] * s.obb_axes[3*a+1] + d[2] * s.obb_axes[3*a+2];
+             lo[a] = (std::min)(lo[a], proj);
+             hi[a] = (std::max)(hi[a], proj);
+           }
+         }
+
+         for (int j = 0; j < 3; ++ j)
+           s.obb_center[j] = s.mean[j];
+         for (int a = 0; a < 3; ++ a)
+         {
+           s.obb_extents[a] = 0.5 * (hi[a] - lo[a]);
+           for (int j = 0; j < 3; ++ j)
+             s.obb_center[j] += 0.5 * (hi[a] + lo[a]) * s.obb_axes[3*a+j];
+         }
+       });
+  }
+
+  // One line per cluster, the cluster of line i having label i
+  inline bool write_cluster_statistics (const std::string& filename, const std::vector<Cluster_statistics>& statistics)
+  {
+    std::ofstream f (filename.c_str());
+    f.precision (std::numeric_limits<double>::digits10 + 2);
+    f << "label,count,"
+      << "centroid_x,centroid_y,centroid_z,"
+      << "min_x,min_y,min_z,max_x,max_y,max_z,"
+      << "cov_xx,cov_xy,cov_xz,cov_yy,cov_yz,cov_zz,"
+      << "obb_center_x,obb_center_y,obb_center_z,"
+      << "obb_axis0_x,obb_axis0_y,obb_axis0_z,obb_axis1_x,obb_axis1_y,obb_axis1_z,"
+      << "obb_axis2_x,obb_axis2_y,obb_axis2_z,"
+      << "obb_extent0,obb_extent1,obb_extent2" << std::endl;
+
+    for (std::size_t i = 0; i < statistics.size(); ++ i)
+    {
+      const Cluster_statistics& s = statistics[i];
+      double cov[6];
+      s.covariance (cov);
+
+      f << i << "," << s.count;
+      for (int j = 0; j < 3; ++ j) f << "," << s.mean[j];
+      for (int j = 0; j < 3; ++ j) f << "," << s.min[j];
+      for (int j = 0; j < 3; ++ j) f << "," << s.max[j];
+      for (int j = 0; j < 6; ++ j) f << "," << cov[j];
+      for (int j = 0; j < 3; ++ j) f << "," << s.obb_center[j];
+      for (int j = 0; j < 9; ++ j) f << "," << s.obb_axes[j];
+      for (int j = 0; j < 3; ++ j) f << "," << s.obb_extents[j];
+      f << std::endl;
     }
 
+    return bool(f);
+  }
+
+  // Applies the output mode to the point set, points not in any
+  // cluster being removed (filter/biggest) or labeled -1 (label)
+  inline void output_clusters (Point_set& points, const std::vector<Point_cluster>& clusters, int method)
+  {
     if (method == 2) // label
     {
       typename Point_set::Property_map<int> label = points.add_property_map<int>("label", -1).first;
@@ -78,9 +316,13 @@ namespace CGALApps
     }
     else
     {
+      std::size_t max_index = 0;
+      for (std::size_t i = 1; i < clusters.size(); ++ i)
+        if (clusters[i].size() > clusters[max_index].size())
+          max_index = i;
 
       typename Point_set::iterator it = points.begin();
-      
+
       if (method == 0) // filter
         for (std::size_t i = 0; i < clusters.size(); ++ i)
           for (std::size_t j = 0; j < clusters[i].size(); ++ j)
@@ -88,7 +330,7 @@ namespace CGALApps
             typename Point_set::iterator current = it ++;
             *current = clusters[i][j];
           }
-      else // biggest
+      else if (!clusters.empty()) // biggest
         for (std::size_t j = 0; j < clusters[max_index].size(); ++ j)
           {
             typename Point_set::iterator current = it ++;
@@ -98,7 +340,7 @@ namespace CGALApps
       points.remove_from(it);
     }
   }
-   
+
 } // namespace CGALApps
 
 #endif // CGALAPPS_ARGS_H_
@@ -0,0 +1,200 @@
+#ifndef CGALAPPS_COVARIANCE_H
+#define CGALAPPS_COVARIANCE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace CGALApps
+{
+
+  // Symmetric 3x3 matrices are stored as their upper triangle
+  // [xx, xy, xz, yy, yz, zz] (same layout as CGAL::compute_vcm())
+
+  // Covariance of n points given as separate x/y/z arrays. Both passes
+  // are plain reductions over contiguous arrays that the compiler can
+  // vectorize.
+  inline void compute_covariance (const double* x, const double* y, const double* z, std::size_t n,
+                           double centroid[3], double cov[6])
+  {
+    double sx = 0., sy = 0., sz = 0.;
+    for (std::size_t i = 0; i < n; ++ i)
+    {
+      sx += x[i];
+      sy += y[i];
+      sz += z[i];
+    }
+    centroid[0] = sx / n;
+    centroid[1] = sy / n;
+    centroid[2] = sz / n;
+
+    double xx = 0., xy = 0., xz = 0., yy = 0., yz = 0., zz = 0.;
+    for (std::size_t i = 0; i < n; ++ i)
+    {
+      double dx = x[i] - centroid[0];
+      double dy = y[i] - centroid[1];
+      double dz = z[i] - centroid[2];
+      xx += dx * dx;
+      xy += dx * dy;
+      xz += dx * dz;
+      yy += dy * dy;
+      yz += dy * dz;
+      zz += dz * dz;
+    }
+    cov[0] = xx; cov[1] = xy; cov[2] = xz;
+    cov[3] = yy; cov[4] = yz; cov[5] = zz;
+  }
+
+  inline void covariance_any_orthogonal (const double v[3], double out[3])
+  {
+    // Cross product with the axis least aligned with v
+    if (std::fabs(v[0]) <= std::fabs(v[1]) && std::fabs(v[0]) <= std::fabs(v[2]))
+    {
+      out[0] = 0.; out[1] = v[2]; out[2] = -v[1];
+    }
+    else if (std::fabs(v[1]) <= std::fabs(v[2]))
+    {
+      out[0] = -v[2]; out[1] = 0.; out[2] = v[0];
+    }
+    else
+    {
+      out[0] = v[1]; out[1] = -v[0]; out[2] = 0.;
+    }
+    double norm = std::sqrt (out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+    for (int j = 0; j < 3; ++ j)
+      out[j] /= norm;
+  }
+
+  // Eigenvector of m for eigenvalue l, as the largest cross product of
+  // two rows of (m - l.I). Returns false if the eigenvalue is multiple.
+  inline bool covariance_eigenvector (const double m[6], double l, double v[3])
+  {
+    const double r0[3] = { m[0] - l, m[1], m[2] };
+    const double r1[3] = { m[1], m[3] - l, m[4] };
+    const double r2[3] = { m[2], m[4], m[5] - l };
+
+    const double c[3][3] = { { r0[1] * r1[2] - r0[2] * r1[1], r0[2] * r1[0] - r0[0] * r1[2], r0[0] * r1[1] - r0[1] * r1[0] },
+                             { r0[1] * r2[2] - r0[2] * r2[1], r0[2] * r2[0] - r0[0] * r2[2], r0[0] * r2[1] - r0[1] * r2[0] },
+                             { r1[1] * r2[2] - r1[2] * r2[1], r1[2] * r2[0] - r1[0] * r2[2], r1[0] * r2[1] - r1[1] * r2[0] } };
+
+    int best = 0;
+    double best_norm = 0.;
+    for (int i = 0; i < 3; ++ i)
+    {
+      double norm = c[i][0] * c[i][0] + c[i][1] * c[i][1] + c[i][2] * c[i][2];
+      if (norm > best_norm)
+      {
+        best = i;
+        best_norm = norm;
+      }
+    }
+
+    if (best_norm < 1e-20)
+      return false;
+
+    best_norm = std::sqrt (best_norm);
+    for (int j = 0; j < 3; ++ j)
+      v[j] = c[best][j] / best_norm;
+    return true;
+  }
+
+  // Closed-form eigen decomposition of a symmetric 3x3 matrix
+  // (trigonometric solution of the characteristic polynomial).
+  // Eigenvalues are sorted in ascending order, eigenvector i is
+  // (vectors[3*i], vectors[3*i+1], vectors[3*i+2]).
+  inline void symmetric_eigen_3 (const double cov[6], double values[3], double vectors[9])
+  {
+    // Scale to avoid over/underflows
+    double scale = 0.;
+    for (int i = 0; i < 6; ++ i)
+      scale = (std::max)(scale, std::fabs(cov[i]));
+    if (scale == 0.)
+      scale = 1.;
+
+    double m[6];
+    for (int i = 0; i < 6; ++ i)
+      m[i] = cov[i] / scale;
+
+    double l[3];
+    const double p1 = m[1] * m[1] + m[2] * m[2] + m[4] * m[4];
+    if (p1 == 0.)
+    {
+      l[0] = m[0]; l[1] = m[3]; l[2] = m[5];
+      std::sort (l, l + 3);
+    }
+    else
+    {
+      const double q = (m[0] + m[3] + m[5]) / 3.;
+      const double p2 = (m[0] - q) * (m[0] - q) + (m[3] - q) * (m[3] - q) + (m[5] - q) * (m[5] - q) + 2. * p1;
+      const double p = std::sqrt (p2 / 6.);
+
+      const double b[6] = { (m[0] - q) / p, m[1] / p, m[2] / p,
+                            (m[3] - q) / p, m[4] / p, (m[5] - q) / p };
+      const double r = 0.5 * (b[0] * (b[3] * b[5] - b[4] * b[4])
+                              - b[1] * (b[1] * b[5] - b[4] * b[2])
+                              + b[2] * (b[1] * b[4] - b[3] * b[2]));
+
+      double phi;
+      if (r <= -1.)
+        phi = M_PI / 3.;
+      else if (r >= 1.)
+        phi = 0.;
+      else
+        phi = std::acos (r) / 3.;
+
+      l[2] = q + 2. * p * std::cos (phi);
+      l[0] = q + 2. * p * std::cos (phi + (2. * M_PI / 3.));
+      l[1] = 3. * q - l[0] - l[2];
+    }
+
+    double* v0 = vectors;
+    double* v1 = vectors + 3;
+    double* v2 = vectors + 6;
+
+    bool has_v0 = covariance_eigenvector (m, l[0], v0);
+    bool has_v2 = covariance_eigenvector (m, l[2], v2);
+
+    if (!has_v0 && !has_v2) // Isotropic
+    {
+      for (int i = 0; i < 9; ++ i)
+        vectors[i] = (i % 4 == 0 ? 1. : 0.);
+    }
+    else
+    {
+      if (!has_v0)
+        covariance_any_orthogonal (v2, v0);
+      else if (!has_v2)
+        covariance_any_orthogonal (v0, v2);
+      else
+      {
+        // Enforce orthogonality
+        double dot = v0[0] * v2[0] + v0[1] * v2[1] + v0[2] * v2[2];
+        for (int j = 0; j < 3; ++ j)
+          v2[j] -= dot * v0[j];
+        double norm = std::sqrt (v2[0] * v2[0] + v2[1] * v2[1] + v2[2] * v2[2]);
+        for (int j = 0; j < 3; ++ j)
+          v2[j] /= norm;
+      }
+
+      v1[0] = v2[1] * v0[2] - v2[2] * v0[1];
+      v1[1] = v2[2] * v0[0] - v2[0] * v0[2];
+      v1[2] = v2[0] * v0[1] - v2[1] * v0[0];
+    }
+
+    for (int i = 0; i < 3; ++ i)
+      values[i] = l[i] * scale;
+  }
+
+  // Eigenvector of the smallest eigenvalue (normal of a PCA plane)
+  inline void symmetric_eigen_3_smallest (const double cov[6], double vector[3])
+  {
+    double values[3];
+    double vectors[9];
+    symmetric_eigen_3 (cov, values, vectors);
+    for (int j = 0; j < 3; ++ j)
+      vector[j] = vectors[j];
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_COVARIANCE_H
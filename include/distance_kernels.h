@@ -0,0 +1,108 @@
+#ifndef CGALAPPS_DISTANCE_KERNELS_H
+#define CGALAPPS_DISTANCE_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CGALAPPS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace CGALApps
+{
+
+  // Leaf scan of the bucket k-d tree: computes the squared distances
+  // d[i] from q to the n points (x[i], y[i], z[i]) and returns the mask
+  // of the points closer than threshold (bit i for point i). n is a
+  // multiple of 16 and at most 64.
+  typedef std::uint64_t (*Distance_kernel) (const float* x, const float* y, const float* z, std::size_t n,
+                                            const float q[3], float threshold, float* d);
+
+  inline std::uint64_t scalar_distance_kernel (const float* x, const float* y, const float* z, std::size_t n,
+                                        const float q[3], float threshold, float* d)
+  {
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < n; ++ i)
+    {
+      float dx = x[i] - q[0];
+      float dy = y[i] - q[1];
+      float dz = z[i] - q[2];
+      d[i] = dx * dx + dy * dy + dz * dz;
+      if (d[i] < threshold)
+        mask |= (std::uint64_t(1) << i);
+    }
+    return mask;
+  }
+
+#ifdef CGALAPPS_X86_KERNELS
+
+  inline __attribute__((target("avx2,fma")))
+  std::uint64_t avx2_distance_kernel (const float* x, const float* y, const float* z, std::size_t n,
+                                      const float q[3], float threshold, float* d)
+  {
+    const __m256 qx = _mm256_set1_ps (q[0]);
+    const __m256 qy = _mm256_set1_ps (q[1]);
+    const __m256 qz = _mm256_set1_ps (q[2]);
+    const __m256 t = _mm256_set1_ps (threshold);
+
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < n; i += 8)
+    {
+      __m256 dx = _mm256_sub_ps (_mm256_loadu_ps (x + i), qx);
+      __m256 dy = _mm256_sub_ps (_mm256_loadu_ps (y + i), qy);
+      __m256 dz = _mm256_sub_ps (_mm256_loadu_ps (z + i), qz);
+      __m256 dist = _mm256_fmadd_ps (dx, dx, _mm256_fmadd_ps (dy, dy, _mm256_mul_ps (dz, dz)));
+      _mm256_storeu_ps (d + i, dist);
+      mask |= std::uint64_t(_mm256_movemask_ps (_mm256_cmp_ps (dist, t, _CMP_LT_OQ))) << i;
+    }
+    return mask;
+  }
+
+  inline __attribute__((target("avx512f")))
+  std::uint64_t avx512_distance_kernel (const float* x, const float* y, const float* z, std::size_t n,
+                                        const float q[3], float threshold, float* d)
+  {
+    const __m512 qx = _mm512_set1_ps (q[0]);
+    const __m512 qy = _mm512_set1_ps (q[1]);
+    const __m512 qz = _mm512_set1_ps (q[2]);
+    const __m512 t = _mm512_set1_ps (threshold);
+
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < n; i += 16)
+    {
+      __m512 dx = _mm512_sub_ps (_mm512_loadu_ps (x + i), qx);
+      __m512 dy = _mm512_sub_ps (_mm512_loadu_ps (y + i), qy);
+      __m512 dz = _mm512_sub_ps (_mm512_loadu_ps (z + i), qz);
+      __m512 dist = _mm512_fmadd_ps (dx, dx, _mm512_fmadd_ps (dy, dy, _mm512_mul_ps (dz, dz)));
+      _mm512_storeu_ps (d + i, dist);
+      mask |= std::uint64_t(_mm512_cmp_ps_mask (dist, t, _CMP_LT_OQ)) << i;
+    }
+    return mask;
+  }
+
+#endif // CGALAPPS_X86_KERNELS
+
+  // Widest kernel supported by the CPU running the program
+  inline Distance_kernel best_distance_kernel (const char** name = nullptr)
+  {
+#ifdef CGALAPPS_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports ("avx512f"))
+    {
+      if (name != nullptr) *name = "avx512";
+      return avx512_distance_kernel;
+    }
+    if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma"))
+    {
+      if (name != nullptr) *name = "avx2";
+      return avx2_distance_kernel;
+    }
+#endif
+    if (name != nullptr) *name = "scalar";
+    return scalar_distance_kernel;
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_DISTANCE_KERNELS_H
@@ -0,0 +1,573 @@
+#ifndef CGALAPPS_GRID_INDEX_H
+#define CGALAPPS_GRID_INDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+#include "arena.h"
+
+namespace CGALApps
+{
+
+  // Spatial index of a point set, saved next to it so that later runs
+  // can insert new points without rebuilding it. Points are stored in
+  // uniform grids whose cell size doubles from one level to the next,
+  // each point being in the first level whose cell size bounds its
+  // neighborhood radius (distance to its k-th nearest neighbor, see
+  // cgal_incremental_update). The points whose neighborhood contains a
+  // given location are thus found by scanning a few cells per level,
+  // whatever the density. Inserting points only shrinks neighborhoods,
+  // so levels stay valid (if conservative) after insertions. Points
+  // are given as positions in the point set (0 to size-1).
+  class Grid_index
+  {
+    static constexpr unsigned int nb_levels = 16;
+    static constexpr int coord_bits = 20;
+
+    double m_cell_size = 0.;
+    double m_origin[3] = { 0., 0., 0. };
+    double m_lo[3] = { 0., 0., 0. }; // Bounding box of the indexed points
+    double m_hi[3] = { 0., 0., 0. };
+    double m_level_radius[nb_levels]; // Largest radius of the points of each level
+    std::size_t m_level_size[nb_levels];
+    std::size_t m_level_cells[nb_levels]; // Non-empty cells of each level
+    std::size_t m_size = 0;
+
+    // Cells sorted by key, with the positions of their points
+    std::vector<std::uint64_t> m_keys;
+    std::vector<std::uint64_t> m_offsets;
+    std::vector<std::uint64_t> m_positions;
+
+    // Points inserted since the index was built or loaded
+    std::unordered_map<std::uint64_t, std::vector<std::uint64_t> > m_inserted;
+    std::vector<std::uint64_t> m_inserted_positions;
+
+  public:
+
+    Grid_index()
+    {
+      clear_levels();
+    }
+
+    std::size_t size() const { return m_size; }
+    double cell_size() const { return m_cell_size; }
+    std::size_t nb_cells() const { return m_keys.size(); }
+
+    // Indexes all points of the point set. If cell_size is 0, it is
+    // derived from the density of the point set, assuming it samples
+    // a 2.5D surface (cells then hold a few points each).
+    void build (const Point_set& points, const Point_set::Property_map<double>& radius, double cell_size = 0.)
+    {
+      m_inserted.clear();
+      m_inserted_positions.clear();
+      clear_levels();
+      m_size = points.size();
+
+      bounding_box (points, m_lo, m_hi);
+      for (int j = 0; j < 3; ++ j)
+        m_origin[j] = m_lo[j];
+
+      m_cell_size = cell_size;
+      if (m_cell_size == 0.)
+      {
+        double dx = m_hi[0] - m_lo[0], dy = m_hi[1] - m_lo[1], dz = m_hi[2] - m_lo[2];
+        double area = (std::max)(dx * dy, (std::max)(dx * dz, dy * dz));
+        m_cell_size = 2. * std::sqrt (area / (std::max)(std::size_t(1), points.size()));
+        if (m_cell_size == 0.)
+          m_cell_size = (std::max)(1e-9, std::sqrt (dx * dx + dy * dy + dz * dz) / points.size());
+      }
+
+      // The bounding box must fit in the range of keys, with margin for
+      // insertions
+      for (int j = 0; j < 3; ++ j)
+        m_cell_size = (std::max)(m_cell_size, std::ldexp (m_hi[j] - m_lo[j], 2 - coord_bits));
+
+      std::vector<std::pair<std::uint64_t, std::uint64_t> > cells (points.size());
+      for (std::size_t i = 0; i < points.size(); ++ i)
+      {
+        typename Point_set::Index idx = *(points.begin() + i);
+        unsigned int level = level_of (radius[idx]);
+        add_to_level (level, radius[idx]);
+        cells[i] = std::make_pair (key (level, points.point(idx)), i);
+      }
+      std::sort (cells.begin(), cells.end());
+
+      m_keys.clear();
+      m_offsets.clear();
+      m_positions.clear();
+      m_positions.reserve (cells.size());
+      for (std::size_t i = 0; i < cells.size(); ++ i)
+      {
+        if (i == 0 || cells[i].first != cells[i-1].first)
+        {
+          m_keys.push_back (cells[i].first);
+          m_offsets.push_back (i);
+        }
+        m_positions.push_back (cells[i].second);
+      }
+      m_offsets.push_back (cells.size());
+      count_level_cells();
+    }
+
+    // Sets the points inserted since the index was built or loaded
+    // (replacing the ones given by a previous call), at the level of
+    // their current radius
+    void set_inserted (const Point_set& points, const Point_set::Property_map<double>& radius,
+                       const std::vector<std::size_t>& positions)
+    {
+      m_inserted.clear();
+      m_inserted_positions.assign (positions.begin(), positions.end());
+      m_size = m_positions.size() + positions.size();
+
+      std::fill (m_level_size, m_level_size + nb_levels, 0);
+      for (std::size_t i = 0; i < m_keys.size(); ++ i)
+        m_level_size[level_of_key (m_keys[i])] += m_offsets[i+1] - m_offsets[i];
+
+      for (std::size_t pos : positions)
+      {
+        typename Point_set::Index idx = *(points.begin() + pos);
+        const Point_3& p = points.point(idx);
+        for (int j = 0; j < 3; ++ j)
+        {
+          m_lo[j] = (std::min)(m_lo[j], p[j]);
+          m_hi[j] = (std::max)(m_hi[j], p[j]);
+        }
+        unsigned int level = level_of (radius[idx]);
+        add_to_level (level, radius[idx]);
+        m_inserted[key (level, p)].push_back (pos);
+      }
+      count_level_cells();
+    }
+
+    // Writes the positions of the k nearest neighbors of query (sorted
+    // by increasing distance, including the query itself if indexed)
+    template <typename OutputIterator>
+    OutputIterator k_neighbors (const Point_set& points, const Point_3& query, std::size_t k,
+                                OutputIterator output) const
+    {
+      k = (std::min)(k, m_size);
+      if (k == 0)
+        return output;
+
+      Monotonic_arena& arena = thread_arena();
+      Arena_scope scope (arena);
+      Arena_vector<std::pair<double, std::size_t> > heap (arena);
+      heap.reserve (k);
+      double worst = std::numeric_limits<double>::infinity();
+
+      // Largest distance from the query to the indexed points
+      double far = 0.;
+      for (int j = 0; j < 3; ++ j)
+      {
+        double d = (std::max)(std::fabs (query[j] - m_lo[j]), std::fabs (query[j] - m_hi[j]));
+        far += d * d;
+      }
+      far = std::sqrt (far);
+
+      const auto visit = [&](std::size_t pos)
+      {
+        double d = CGAL::squared_distance (query, points.point(*(points.begin() + pos)));
+        if (heap.size() < k)
+        {
+          heap.push_back (std::make_pair (d, pos));
+          std::push_heap (heap.begin(), heap.end());
+          if (heap.size() == k)
+            worst = heap.front().first;
+        }
+        else if (d < worst)
+        {
+          std::pop_heap (heap.begin(), heap.end());
+          heap.back() = std::make_pair (d, pos);
+          std::push_heap (heap.begin(), heap.end());
+          worst = heap.front().first;
+        }
+      };
+
+      // The search radius doubles until it contains the k neighbors. At
+      // each step, all levels are scanned up to the search radius, or
+      // only up to the current k-th neighbor once k points are found (a
+      // point at distance d is at most floor(d/cell)+1 rings away). If
+      // the rings left to scan have more cells than the level has
+      // non-empty cells (fine levels far from their points), the
+      // non-empty cells are scanned directly instead, once.
+      const std::int64_t exhausted = std::numeric_limits<std::int64_t>::max();
+      std::int64_t c[nb_levels][3];
+      std::int64_t next_ring[nb_levels];
+      for (unsigned int level = 0; level < nb_levels; ++ level)
+      {
+        cell_coordinates (level, query, c[level]);
+        next_ring[level] = 0;
+      }
+
+      for (double radius = m_cell_size; ; radius *= 2.)
+      {
+        for (unsigned int level = 0; level < nb_levels; ++ level)
+        {
+          if (m_level_size[level] == 0 || next_ring[level] == exhausted)
+            continue;
+
+          const double bound = (heap.size() == k ? (std::min)(radius, std::sqrt (worst)) : radius);
+          const std::int64_t last_ring = std::int64_t(std::floor (bound / level_cell_size (level))) + 1;
+          if (next_ring[level] > last_ring)
+            continue;
+
+          const double outer = double(2 * last_ring + 1);
+          const double inner = (next_ring[level] == 0 ? 0. : double(2 * next_ring[level] - 1));
+          if (outer * outer * outer - inner * inner * inner > double(m_level_cells[level]))
+          {
+            for_each_in_level (level, c[level], next_ring[level], visit);
+            next_ring[level] = exhausted;
+          }
+          else
+            for (; next_ring[level] <= last_ring; ++ next_ring[level])
+              for_each_in_ring (level, c[level], next_ring[level], visit);
+        }
+
+        if ((heap.size() == k && worst <= radius * radius) || radius > far)
+          break;
+      }
+
+      std::sort_heap (heap.begin(), heap.end());
+      for (const std::pair<double, std::size_t>& h : heap)
+        *(output ++) = h.second;
+      return output;
+    }
+
+    // Calls f(position) for all points indexed when the index was built
+    // or loaded whose neighborhood (ball of radius given by the radius
+    // map) contains location
+    template <typename Function>
+    void neighborhoods_containing (const Point_set& points, const Point_set::Property_map<double>& radius,
+                                   const Point_3& location, const Function& f) const
+    {
+      for (unsigned int level = 0; level < nb_levels; ++ level)
+      {
+        if (m_level_size[level] == 0)
+          continue;
+
+        const double cell = level_cell_size (level);
+        std::int64_t c[3];
+        cell_coordinates (level, location, c);
+        const std::int64_t extent = std::int64_t(std::ceil (m_level_radius[level] / cell));
+
+        std::int64_t d[3];
+        for (d[0] = -extent; d[0] <= extent; ++ d[0])
+          for (d[1] = -extent; d[1] <= extent; ++ d[1])
+            for (d[2] = -extent; d[2] <= extent; ++ d[2])
+            {
+              if (!in_range (c[0] + d[0], c[1] + d[1], c[2] + d[2]))
+                continue;
+              std::uint64_t k = key (level, c[0] + d[0], c[1] + d[1], c[2] + d[2]);
+              std::vector<std::uint64_t>::const_iterator it = std::lower_bound (m_keys.begin(), m_keys.end(), k);
+              if (it == m_keys.end() || *it != k)
+                continue;
+              std::size_t cell_index = it - m_keys.begin();
+              for (std::size_t i = m_offsets[cell_index]; i < m_offsets[cell_index + 1]; ++ i)
+              {
+                typename Point_set::Index idx = *(points.begin() + m_positions[i]);
+                double r = radius[idx];
+                if (CGAL::squared_distance (location, points.point(idx)) <= r * r)
+                  f (std::size_t(m_positions[i]));
+              }
+            }
+      }
+    }
+
+    // Saves the index, inserted points included
+    bool save (const std::string& filename) const
+    {
+      std::vector<std::pair<std::uint64_t, std::uint64_t> > inserted;
+      inserted.reserve (m_inserted_positions.size());
+      for (const std::pair<const std::uint64_t, std::vector<std::uint64_t> >& cell : m_inserted)
+        for (std::uint64_t pos : cell.second)
+          inserted.push_back (std::make_pair (cell.first, pos));
+      std::sort (inserted.begin(), inserted.end());
+
+      // Merge of the sorted cells with the sorted inserted points
+      std::vector<std::uint64_t> keys, offsets, positions;
+      keys.reserve (m_keys.size());
+      offsets.reserve (m_offsets.size());
+      positions.reserve (m_size);
+      std::size_t c = 0, n = 0;
+      while (c < m_keys.size() || n < inserted.size())
+      {
+        std::uint64_t k = (n == inserted.size() || (c < m_keys.size() && m_keys[c] <= inserted[n].first)
+                           ? m_keys[c] : inserted[n].first);
+        keys.push_back (k);
+        offsets.push_back (positions.size());
+        if (c < m_keys.size() && m_keys[c] == k)
+        {
+          positions.insert (positions.end(), m_positions.begin() + m_offsets[c], m_positions.begin() + m_offsets[c+1]);
+          ++ c;
+        }
+        for (; n < inserted.size() && inserted[n].first == k; ++ n)
+          positions.push_back (inserted[n].second);
+      }
+      offsets.push_back (positions.size());
+
+      std::ofstream f (filename.c_str(), std::ios::binary);
+      f.write ("CGALAPPS_GRID 1\n", 16);
+      write_value (f, std::uint64_t(positions.size()));
+      write_value (f, m_cell_size);
+      write_array (f, m_origin, 3);
+      write_array (f, m_lo, 3);
+      write_array (f, m_hi, 3);
+      write_array (f, m_level_radius, nb_levels);
+      write_value (f, std::uint64_t(keys.size()));
+      write_array (f, keys.data(), keys.size());
+      write_array (f, offsets.data(), offsets.size());
+      write_array (f, positions.data(), positions.size());
+      return bool(f);
+    }
+
+    // Loads an index saved by save(). Returns false if the file cannot
+    // be read or does not index nb_points points.
+    bool load (const std::string& filename, std::size_t nb_points)
+    {
+      std::ifstream f (filename.c_str(), std::ios::binary);
+      char magic[16];
+      if (!f.read (magic, 16) || std::memcmp (magic, "CGALAPPS_GRID 1\n", 16) != 0)
+        return false;
+
+      std::uint64_t size = 0, nb_cells = 0;
+      read_value (f, size);
+      if (!f || size != nb_points)
+        return false;
+
+      read_value (f, m_cell_size);
+      read_array (f, m_origin, 3);
+      read_array (f, m_lo, 3);
+      read_array (f, m_hi, 3);
+      read_array (f, m_level_radius, nb_levels);
+      read_value (f, nb_cells);
+      if (!f)
+        return false;
+
+      m_keys.resize (nb_cells);
+      m_offsets.resize (nb_cells + 1);
+      m_positions.resize (size);
+      read_array (f, m_keys.data(), m_keys.size());
+      read_array (f, m_offsets.data(), m_offsets.size());
+      read_array (f, m_positions.data(), m_positions.size());
+      if (!f)
+        return false;
+
+      m_size = size;
+      m_inserted.clear();
+      m_inserted_positions.clear();
+      std::fill (m_level_size, m_level_size + nb_levels, 0);
+      for (std::size_t i = 0; i < m_keys.size(); ++ i)
+        m_level_size[level_of_key (m_keys[i])] += m_offsets[i+1] - m_offsets[i];
+      count_level_cells();
+      return true;
+    }
+
+  private:
+
+    void clear_levels()
+    {
+      std::fill (m_level_radius, m_level_radius + nb_levels, 0.);
+      std::fill (m_level_size, m_level_size + nb_levels, 0);
+      std::fill (m_level_cells, m_level_cells + nb_levels, 0);
+    }
+
+    void count_level_cells()
+    {
+      std::fill (m_level_cells, m_level_cells + nb_levels, 0);
+      for (std::uint64_t k : m_keys)
+        ++ m_level_cells[level_of_key (k)];
+      for (const std::pair<const std::uint64_t, std::vector<std::uint64_t> >& cell : m_inserted)
+        ++ m_level_cells[level_of_key (cell.first)];
+    }
+
+    void add_to_level (unsigned int level, double radius)
+    {
+      m_level_radius[level] = (std::max)(m_level_radius[level], radius);
+      ++ m_level_size[level];
+    }
+
+    static void bounding_box (const Point_set& points, double lo[3], double hi[3])
+    {
+      for (int j = 0; j < 3; ++ j)
+      {
+        lo[j] = std::numeric_limits<double>::max();
+        hi[j] = -std::numeric_limits<double>::max();
+      }
+      for (typename Point_set::const_iterator it = points.begin(); it != points.end(); ++ it)
+      {
+        const Point_3& p = points.point(*it);
+        for (int j = 0; j < 3; ++ j)
+        {
+          lo[j] = (std::min)(lo[j], p[j]);
+          hi[j] = (std::max)(hi[j], p[j]);
+        }
+      }
+      if (points.empty())
+        for (int j = 0; j < 3; ++ j)
+          lo[j] = hi[j] = 0.;
+    }
+
+    double level_cell_size (unsigned int level) const
+    {
+      return std::ldexp (m_cell_size, int(level));
+    }
+
+    // Smallest level whose cell size bounds radius (the last level
+    // takes all larger radii)
+    unsigned int level_of (double radius) const
+    {
+      unsigned int level = 0;
+      while (level + 1 < nb_levels && level_cell_size (level) < radius)
+        ++ level;
+      return level;
+    }
+
+    static unsigned int level_of_key (std::uint64_t key)
+    {
+      return (unsigned int)(key >> (3 * coord_bits));
+    }
+
+    void cell_coordinates (unsigned int level, const Point_3& p, std::int64_t c[3]) const
+    {
+      const double cell = level_cell_size (level);
+      for (int j = 0; j < 3; ++ j)
+        c[j] = std::int64_t(std::floor ((p[j] - m_origin[j]) / cell));
+    }
+
+    // Keys hold 2^20 cells per axis around the origin. Points inserted
+    // farther away are stored in the border cells, which are the only
+    // ones scanned beyond the range (so that no cell is seen twice).
+    static bool in_range (std::int64_t x, std::int64_t y, std::int64_t z)
+    {
+      const std::int64_t half = std::int64_t(1) << (coord_bits - 1);
+      return (x >= -half && x < half && y >= -half && y < half && z >= -half && z < half);
+    }
+
+    static std::uint64_t key (unsigned int level, std::int64_t x, std::int64_t y, std::int64_t z)
+    {
+      const std::int64_t half = std::int64_t(1) << (coord_bits - 1);
+      const std::int64_t c[3] = { x, y, z };
+      std::uint64_t out = level;
+      for (int j = 0; j < 3; ++ j)
+        out = (out << coord_bits) | std::uint64_t((std::min)(half - 1, (std::max)(-half, c[j])) + half);
+      return out;
+    }
+
+    std::uint64_t key (unsigned int level, const Point_3& p) const
+    {
+      std::int64_t c[3];
+      cell_coordinates (level, p, c);
+      return key (level, c[0], c[1], c[2]);
+    }
+
+    template <typename Function>
+    void for_each_in_cell (std::uint64_t k, const Function& f) const
+    {
+      std::vector<std::uint64_t>::const_iterator it = std::lower_bound (m_keys.begin(), m_keys.end(), k);
+      if (it != m_keys.end() && *it == k)
+      {
+        std::size_t cell_index = it - m_keys.begin();
+        for (std::size_t i = m_offsets[cell_index]; i < m_offsets[cell_index + 1]; ++ i)
+          f (std::size_t(m_positions[i]));
+      }
+
+      if (!m_inserted.empty())
+      {
+        typename std::unordered_map<std::uint64_t, std::vector<std::uint64_t> >::const_iterator
+          found = m_inserted.find (k);
+        if (found != m_inserted.end())
+          for (std::uint64_t pos : found->second)
+            f (std::size_t(pos));
+      }
+    }
+
+    // Cells at Chebyshev distance r from cell c
+    template <typename Function>
+    void for_each_in_ring (unsigned int level, const std::int64_t c[3], std::int64_t r, const Function& f) const
+    {
+      for (std::int64_t dx = -r; dx <= r; ++ dx)
+        for (std::int64_t dy = -r; dy <= r; ++ dy)
+        {
+          bool on_border = (dx == -r || dx == r || dy == -r || dy == r);
+          for (std::int64_t dz = -r; dz <= r; dz += (on_border || r == 0 ? 1 : 2 * r))
+            if (in_range (c[0] + dx, c[1] + dy, c[2] + dz))
+              for_each_in_cell (key (level, c[0] + dx, c[1] + dy, c[2] + dz), f);
+        }
+    }
+
+    // Chebyshev distance between the cell of key and cell c
+    static std::int64_t ring_of_key (std::uint64_t key, const std::int64_t c[3])
+    {
+      const std::int64_t half = std::int64_t(1) << (coord_bits - 1);
+      const std::uint64_t mask = (std::uint64_t(1) << coord_bits) - 1;
+      std::int64_t ring = 0;
+      for (int j = 0; j < 3; ++ j)
+      {
+        std::int64_t x = std::int64_t((key >> (coord_bits * (2 - j))) & mask) - half;
+        ring = (std::max)(ring, (x > c[j] ? x - c[j] : c[j] - x));
+      }
+      return ring;
+    }
+
+    // Non-empty cells of level at Chebyshev distance at least min_ring
+    // from cell c (same cells as the rings from min_ring on)
+    template <typename Function>
+    void for_each_in_level (unsigned int level, const std::int64_t c[3], std::int64_t min_ring,
+                            const Function& f) const
+    {
+      std::vector<std::uint64_t>::const_iterator begin
+        = std::lower_bound (m_keys.begin(), m_keys.end(), std::uint64_t(level) << (3 * coord_bits));
+      std::vector<std::uint64_t>::const_iterator end
+        = (level + 1 == nb_levels ? m_keys.end()
+           : std::lower_bound (begin, m_keys.end(), std::uint64_t(level + 1) << (3 * coord_bits)));
+      for (std::vector<std::uint64_t>::const_iterator it = begin; it != end; ++ it)
+        if (ring_of_key (*it, c) >= min_ring)
+        {
+          std::size_t cell_index = it - m_keys.begin();
+          for (std::size_t i = m_offsets[cell_index]; i < m_offsets[cell_index + 1]; ++ i)
+            f (std::size_t(m_positions[i]));
+        }
+
+      for (const std::pair<const std::uint64_t, std::vector<std::uint64_t> >& cell : m_inserted)
+        if (level_of_key (cell.first) == level && ring_of_key (cell.first, c) >= min_ring)
+          for (std::uint64_t pos : cell.second)
+            f (std::size_t(pos));
+    }
+
+    template <typename T>
+    static void write_value (std::ofstream& f, const T& value)
+    {
+      f.write (reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static void write_array (std::ofstream& f, const T* values, std::size_t size)
+    {
+      f.write (reinterpret_cast<const char*>(values), std::streamsize(size * sizeof(T)));
+    }
+
+    template <typename T>
+    static void read_value (std::ifstream& f, T& value)
+    {
+      f.read (reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static void read_array (std::ifstream& f, T* values, std::size_t size)
+    {
+      f.read (reinterpret_cast<char*>(values), std::streamsize(size * sizeof(T)));
+    }
+  };
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_GRID_INDEX_H
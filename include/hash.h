@@ -0,0 +1,254 @@
+#ifndef CGALAPPS_HASH_H
+#define CGALAPPS_HASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace CGALApps
+{
+
+  // Streaming XXH64 hash: several GB/s, so that hashing a file while
+  // reading it is not noticeable
+  class Hash_64
+  {
+    static constexpr std::uint64_t P1 = 0x9E3779B185EBCA87ull;
+    static constexpr std::uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+    static constexpr std::uint64_t P3 = 0x165667B19E3779F9ull;
+    static constexpr std::uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+    static constexpr std::uint64_t P5 = 0x27D4EB2F165667C5ull;
+
+    std::uint64_t m_seed;
+    std::uint64_t m_v[4];
+    unsigned char m_buffer[32];
+    std::size_t m_buffer_size;
+    std::uint64_t m_length;
+
+    static std::uint64_t rotl (std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    static std::uint64_t read_64 (const unsigned char* p)
+    {
+      std::uint64_t v;
+      std::memcpy (&v, p, 8);
+      return v;
+    }
+
+    static std::uint32_t read_32 (const unsigned char* p)
+    {
+      std::uint32_t v;
+      std::memcpy (&v, p, 4);
+      return v;
+    }
+
+    static std::uint64_t round (std::uint64_t acc, std::uint64_t input)
+    {
+      acc += input * P2;
+      acc = rotl (acc, 31);
+      return acc * P1;
+    }
+
+    static std::uint64_t merge_round (std::uint64_t acc, std::uint64_t val)
+    {
+      acc ^= round (0, val);
+      return acc * P1 + P4;
+    }
+
+    void stripe (const unsigned char* p)
+    {
+      m_v[0] = round (m_v[0], read_64 (p));
+      m_v[1] = round (m_v[1], read_64 (p + 8));
+      m_v[2] = round (m_v[2], read_64 (p + 16));
+      m_v[3] = round (m_v[3], read_64 (p + 24));
+    }
+
+  public:
+
+    Hash_64 (std::uint64_t seed = 0) : m_seed (seed), m_buffer_size (0), m_length (0)
+    {
+      m_v[0] = seed + P1 + P2;
+      m_v[1] = seed + P2;
+      m_v[2] = seed;
+      m_v[3] = seed - P1;
+    }
+
+    void add (const void* data, std::size_t size)
+    {
+      const unsigned char* p = static_cast<const unsigned char*>(data);
+      const unsigned char* end = p + size;
+      m_length += size;
+
+      if (m_buffer_size + size < 32)
+      {
+        std::memcpy (m_buffer + m_buffer_size, p, size);
+        m_buffer_size += size;
+        return;
+      }
+
+      if (m_buffer_size != 0)
+      {
+        std::memcpy (m_buffer + m_buffer_size, p, 32 - m_buffer_size);
+        p += 32 - m_buffer_size;
+        stripe (m_buffer);
+        m_buffer_size = 0;
+      }
+
+      for (; p + 32 <= end; p += 32)
+        stripe (p);
+
+      m_buffer_size = std::size_t(end - p);
+      std::memcpy (m_buffer, p, m_buffer_size);
+    }
+
+    void add (const std::string& str)
+    {
+      add (str.data(), str.size());
+      // Separator so that ("ab", "c") and ("a", "bc") differ
+      add ("", 1);
+    }
+
+    std::uint64_t digest() const
+    {
+      std::uint64_t h;
+      if (m_length >= 32)
+      {
+        h = rotl (m_v[0], 1) + rotl (m_v[1], 7) + rotl (m_v[2], 12) + rotl (m_v[3], 18);
+        for (int i = 0; i < 4; ++ i)
+          h = merge_round (h, m_v[i]);
+      }
+      else
+        h = m_seed + P5;
+
+      h += m_length;
+
+      const unsigned char* p = m_buffer;
+      const unsigned char* end = m_buffer + m_buffer_size;
+      for (; p + 8 <= end; p += 8)
+      {
+        h ^= round (0, read_64 (p));
+        h = rotl (h, 27) * P1 + P4;
+      }
+      if (p + 4 <= end)
+      {
+        h ^= std::uint64_t(read_32 (p)) * P1;
+        h = rotl (h, 23) * P2 + P3;
+        p += 4;
+      }
+      for (; p < end; ++ p)
+      {
+        h ^= (*p) * P5;
+        h = rotl (h, 11) * P1;
+      }
+
+      h ^= h >> 33;
+      h *= P2;
+      h ^= h >> 29;
+      h *= P3;
+      h ^= h >> 32;
+      return h;
+    }
+  };
+
+  inline std::string hash_to_string (std::uint64_t hash)
+  {
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return oss.str();
+  }
+
+  // Input stream buffer hashing the bytes of another stream buffer as
+  // they are read. Readers may seek back (to detect the format for
+  // example): bytes are only hashed once, in order, and digest() hashes
+  // the bytes that were not read.
+  class Hashing_streambuf : public std::streambuf
+  {
+    std::streambuf* m_source;
+    std::vector<char> m_buffer;
+    Hash_64 m_hash;
+    std::streamoff m_position; // Position of the buffer in the source
+    std::streamoff m_hashed;   // Number of bytes hashed
+
+  public:
+
+    Hashing_streambuf (std::streambuf* source, std::size_t buffer_size = (1 << 20))
+      : m_source (source), m_buffer (buffer_size), m_position (0), m_hashed (0)
+    {
+      setg (m_buffer.data(), m_buffer.data(), m_buffer.data());
+    }
+
+    std::uint64_t digest()
+    {
+      // Bytes not hashed yet are after the current position of the
+      // source, unless the reader seeked
+      std::streamoff source_position = m_position + (egptr() - eback());
+      if (source_position != m_hashed)
+        m_source->pubseekpos (m_hashed, std::ios_base::in);
+
+      std::streamsize nb_read;
+      while ((nb_read = m_source->sgetn (m_buffer.data(), std::streamsize(m_buffer.size()))) > 0)
+        m_hash.add (m_buffer.data(), std::size_t(nb_read));
+
+      setg (m_buffer.data(), m_buffer.data(), m_buffer.data());
+      return m_hash.digest();
+    }
+
+  protected:
+
+    int_type underflow()
+    {
+      if (gptr() < egptr())
+        return traits_type::to_int_type (*gptr());
+
+      m_position += (egptr() - eback());
+      std::streamsize nb_read = m_source->sgetn (m_buffer.data(), std::streamsize(m_buffer.size()));
+      if (nb_read <= 0)
+      {
+        setg (m_buffer.data(), m_buffer.data(), m_buffer.data());
+        return traits_type::eof();
+      }
+
+      if (m_position <= m_hashed && m_position + nb_read > m_hashed)
+      {
+        m_hash.add (m_buffer.data() + (m_hashed - m_position), std::size_t(m_position + nb_read - m_hashed));
+        m_hashed = m_position + nb_read;
+      }
+
+      setg (m_buffer.data(), m_buffer.data(), m_buffer.data() + nb_read);
+      return traits_type::to_int_type (*gptr());
+    }
+
+    pos_type seekoff (off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+    {
+      if (dir == std::ios_base::cur)
+      {
+        off += m_position + (gptr() - eback());
+        if (off == m_position + (gptr() - eback()))
+          return pos_type (off);
+        dir = std::ios_base::beg;
+      }
+      return seek (m_source->pubseekoff (off, dir, which));
+    }
+
+    pos_type seekpos (pos_type pos, std::ios_base::openmode which)
+    {
+      return seek (m_source->pubseekpos (pos, which));
+    }
+
+  private:
+
+    pos_type seek (pos_type pos)
+    {
+      if (pos == pos_type (off_type (-1)))
+        return pos;
+      m_position = off_type (pos);
+      setg (m_buffer.data(), m_buffer.data(), m_buffer.data());
+      return pos;
+    }
+  };
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_HASH_H
@@ -0,0 +1,227 @@
+#ifndef CGALAPPS_INCREMENTAL_UPDATE_H
+#define CGALAPPS_INCREMENTAL_UPDATE_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+#include "arena.h"
+#include "grid_index.h"
+#include "jet_fitting.h"
+#include "parallel.h"
+#include "progress.h"
+
+namespace CGALApps
+{
+
+  struct Incremental_statistics
+  {
+    std::size_t nb_inserted = 0;
+    std::size_t nb_affected = 0;  // Points already processed whose neighborhood changed
+    std::size_t nb_propagated = 0; // Normals oriented from an oriented neighbor
+    std::size_t nb_seeds = 0;      // Normals oriented upwards (no oriented neighbor)
+  };
+
+  // Properties maintained by incremental_update()
+  inline bool has_incremental_properties (const Point_set& points)
+  {
+    return (points.has_normal_map()
+            && points.property_map<double>("knn_radius").second
+            && points.property_map<double>("outlier_score").second);
+  }
+
+  inline void add_incremental_properties (Point_set& points)
+  {
+    if (!points.has_normal_map())
+      points.add_normal_map();
+    points.add_property_map<double>("knn_radius", 0.);
+    points.add_property_map<double>("outlier_score", 0.);
+  }
+
+  // Updates a processed point set after new points were appended. The
+  // first nb_indexed points are the processed ones, indexed by index,
+  // with their k nearest neighbors summarized by these properties:
+  //  - knn_radius: distance to the k-th nearest neighbor
+  //  - outlier_score: average squared distance to the k nearest
+  //    neighbors (same score as cgal_remove_outliers)
+  //  - normal: oriented jet normal of the given degree
+  // Only the new points and the processed points that have a new point
+  // in their neighborhood (at most knn_radius away) are recomputed. The
+  // normals of the latter keep their orientation, and new normals are
+  // oriented by propagation from oriented neighbors, along the most
+  // parallel normals first (as in CGAL::mst_orient_normals()). If
+  // nb_indexed is 0, all points are processed and the index is built.
+  inline void incremental_update (Point_set& points, std::size_t nb_indexed, Grid_index& index,
+                           unsigned int k, unsigned int degree, double cell_size,
+                           Incremental_statistics& statistics)
+  {
+    Point_set::Property_map<double> radius = points.property_map<double>("knn_radius").first;
+    Point_set::Property_map<double> score = points.property_map<double>("outlier_score").first;
+
+    std::vector<std::size_t> inserted;
+    for (std::size_t i = nb_indexed; i < points.size(); ++ i)
+    {
+      radius[*(points.begin() + i)] = 0.;
+      inserted.push_back (i);
+    }
+    statistics.nb_inserted = inserted.size();
+
+    // Points to recompute: new points, then affected points
+    std::vector<std::size_t> dirty = inserted;
+    if (nb_indexed == 0)
+      index.build (points, radius, cell_size);
+    else
+    {
+      index.set_inserted (points, radius, inserted);
+
+      std::vector<char> affected (nb_indexed, 0);
+      for (std::size_t i : inserted)
+        index.neighborhoods_containing (points, radius, points.point(*(points.begin() + i)),
+                                        [&](std::size_t pos)
+                                        {
+                                          if (!affected[pos])
+                                          {
+                                            affected[pos] = 1;
+                                            dirty.push_back (pos);
+                                          }
+                                        });
+      statistics.nb_affected = dirty.size() - inserted.size();
+    }
+
+    const std::size_t nb_neighbors = (std::min)(std::size_t(k), points.size());
+    std::vector<std::size_t> neighbors (dirty.size() * nb_neighbors);
+
+    Progress progress ("Incremental update", dirty.size(), "point");
+    CGALApps::parallel_for
+      (0, dirty.size(),
+       [&](std::size_t d)
+       {
+         const std::size_t i = dirty[d];
+         typename Point_set::Index idx = *(points.begin() + i);
+         const Point_3& query = points.point(idx);
+
+         std::size_t* begin = neighbors.data() + d * nb_neighbors;
+         index.k_neighbors (points, query, nb_neighbors, begin);
+
+         Monotonic_arena& arena = thread_arena();
+         Arena_scope scope (arena);
+         Arena_vector<double> coords (3 * nb_neighbors, 0., arena);
+         double* x = coords.data();
+         double* y = x + nb_neighbors;
+         double* z = y + nb_neighbors;
+
+         double sum = 0.;
+         for (std::size_t j = 0; j < nb_neighbors; ++ j)
+         {
+           const Point_3& p = points.point(*(points.begin() + begin[j]));
+           x[j] = p.x();
+           y[j] = p.y();
+           z[j] = p.z();
+           sum += CGAL::squared_distance (query, p);
+         }
+         radius[idx] = std::sqrt (CGAL::squared_distance (query, points.point(*(points.begin() + begin[nb_neighbors - 1]))));
+         score[idx] = sum / nb_neighbors;
+
+         const double p0[3] = { query.x(), query.y(), query.z() };
+         double projection[3], normal[3];
+         fit_jet (degree, x, y, z, nb_neighbors, p0, projection, normal);
+
+         // Processed points keep their orientation
+         Vector_3 n (normal[0], normal[1], normal[2]);
+         if (i < nb_indexed && n * points.normal(idx) < 0)
+           n = -n;
+         points.normal(idx) = n;
+       }, progress);
+
+    // Propagation of orientations to the new points (minimum spanning
+    // tree of the neighbor graph rooted at the oriented points)
+    std::unordered_map<std::size_t, std::size_t> pending; // Position -> dirty index
+    for (std::size_t d = 0; d < inserted.size(); ++ d)
+      pending[dirty[d]] = d;
+
+    std::vector<std::vector<std::size_t> > adjacency (inserted.size()); // Pending neighbors, both ways
+    typedef std::tuple<double, std::size_t, std::size_t> Edge; // Weight, dirty index, oriented position
+    std::priority_queue<Edge, std::vector<Edge>, std::greater<Edge> > queue;
+
+    auto weight = [&](std::size_t a, std::size_t b) -> double
+                  {
+                    return 1. - std::fabs (points.normal(*(points.begin() + a)) * points.normal(*(points.begin() + b)));
+                  };
+
+    for (std::size_t d = 0; d < inserted.size(); ++ d)
+      for (std::size_t j = 0; j < nb_neighbors; ++ j)
+      {
+        std::size_t n = neighbors[d * nb_neighbors + j];
+        if (n == dirty[d])
+          continue;
+        std::unordered_map<std::size_t, std::size_t>::const_iterator found = pending.find (n);
+        if (found == pending.end())
+          queue.push (Edge (weight (dirty[d], n), d, n));
+        else
+        {
+          adjacency[d].push_back (found->second);
+          adjacency[found->second].push_back (d);
+        }
+      }
+
+    std::vector<char> oriented (inserted.size(), 0);
+    std::vector<std::size_t> by_height (inserted.size());
+    for (std::size_t d = 0; d < by_height.size(); ++ d)
+      by_height[d] = d;
+    std::sort (by_height.begin(), by_height.end(),
+               [&](std::size_t a, std::size_t b) -> bool
+               {
+                 return points.point(*(points.begin() + dirty[a])).z() > points.point(*(points.begin() + dirty[b])).z();
+               });
+
+    std::size_t next_seed = 0;
+    std::size_t nb_oriented = 0;
+    while (nb_oriented != inserted.size())
+    {
+      std::size_t d;
+      if (queue.empty())
+      {
+        // No oriented neighbor: the highest point is oriented upwards
+        while (oriented[by_height[next_seed]])
+          ++ next_seed;
+        d = by_height[next_seed];
+        Vector_3& n = points.normal(*(points.begin() + dirty[d]));
+        if (n.z() < 0)
+          n = -n;
+        ++ statistics.nb_seeds;
+      }
+      else
+      {
+        Edge e = queue.top();
+        queue.pop();
+        d = std::get<1>(e);
+        if (oriented[d])
+          continue;
+        Vector_3& n = points.normal(*(points.begin() + dirty[d]));
+        if (n * points.normal(*(points.begin() + std::get<2>(e))) < 0)
+          n = -n;
+        ++ statistics.nb_propagated;
+      }
+
+      oriented[d] = 1;
+      ++ nb_oriented;
+      for (std::size_t a : adjacency[d])
+        if (!oriented[a])
+          queue.push (Edge (weight (dirty[a], dirty[d]), a, dirty[d]));
+    }
+
+    // New points move to the level of their radius
+    if (nb_indexed == 0)
+      index.build (points, radius, index.cell_size());
+    else
+      index.set_inserted (points, radius, inserted);
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_INCREMENTAL_UPDATE_H
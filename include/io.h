@@ -1,17 +1,20 @@
 #ifndef CGALAPPS_IO_H
 #define CGALAPPS_IO_H
 
+#include <cstdint>
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <vector>
 #include <CGAL/Point_set_3/IO.h>
 
+#include "hash.h"
 #include "types.h"
 
 namespace CGALApps
 {
 
-void read_point_set (const std::string& filename, Point_set& points, bool try_stdcin = true)
+inline void read_point_set (const std::string& filename, Point_set& points, bool try_stdcin = true)
 {
   // Otherwise, read from std::cin
   if (filename == "")
@@ -28,7 +31,25 @@ void read_point_set (const std::string& filename, Point_set& points, bool try_st
   }
 }
 
-void write_point_set (const std::string& filename, const Point_set& points, bool binary = true)
+// Same as read_point_set(), also returning a hash of the bytes read
+inline std::uint64_t read_point_set_and_hash (const std::string& filename, Point_set& points)
+{
+  if (filename == "")
+  {
+    Hashing_streambuf buffer (std::cin.rdbuf());
+    std::istream stream (&buffer);
+    CGAL::read_ply_point_set (stream, points);
+    return buffer.digest();
+  }
+
+  std::ifstream f(filename.c_str(), std::ios::binary);
+  Hashing_streambuf buffer (f.rdbuf());
+  std::istream stream (&buffer);
+  stream >> points;
+  return buffer.digest();
+}
+
+inline void write_point_set (const std::string& filename, const Point_set& points, bool binary = true)
 {
   // Otherwise, write to std::cout
   if (filename == "")
@@ -72,7 +93,20 @@ void write_surface_to_stream (const Point_set& points,
 }
 
 template <typename FacetRange>
-void write_surface (const std::string& filename, const Point_set& points,
+void write_surface_to_stream (const std::vector<Point_3>& points,
+                              const FacetRange& facets,
+                              std::ostream& stream)
+{
+  stream.precision (std::numeric_limits<double>::digits10 + 2);
+  stream << "OFF\n" << points.size() << " " << facets.size() << " 0\n";
+  for (const Point_3& p : points)
+    stream << p << std::endl;
+  for (const typename FacetRange::const_iterator::value_type& f : facets)
+    stream << "3 " << f[0] << " " << f[1] << " " << f[2] << std::endl;
+}
+
+template <typename PointRange, typename FacetRange>
+void write_surface (const std::string& filename, const PointRange& points,
                     const FacetRange& facets)
 {
   // Otherwise, write to std::cout
@@ -85,7 +119,7 @@ void write_surface (const std::string& filename, const Point_set& points,
   }
 }
 
-void write_surface (const std::string& filename, const Polyhedron& mesh)
+inline void write_surface (const std::string& filename, const Polyhedron& mesh)
 {
   // Otherwise, write to std::cout
   if (filename == "")
@@ -101,7 +135,21 @@ void write_surface (const std::string& filename, const Polyhedron& mesh)
   }
 }
 
-bool extension_of_file_is (const std::string& filename, const char* ext)
+template <typename T>
+void write_value (const std::string& filename, const T& value)
+{
+  // Otherwise, write to std::cout
+  if (filename == "")
+    std::cout << value << std::endl;
+  else
+  {
+    std::ofstream f(filename.c_str());
+    f.precision (std::cout.precision());
+    f << value << std::endl;
+  }
+}
+
+inline bool extension_of_file_is (const std::string& filename, const char* ext)
 {
   if(filename.size() < 5) // Filename is at least a.ext
     return false;
@@ -0,0 +1,246 @@
+#ifndef CGALAPPS_JET_FITTING_H
+#define CGALAPPS_JET_FITTING_H
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "types.h"
+#include "covariance.h"
+#include "neighbor_search.h"
+#include "parallel.h"
+#include "progress.h"
+#include "threads.h"
+
+namespace CGALApps
+{
+
+  // Least squares fitting of a jet (bivariate polynomial) of a given
+  // degree, with the same steps as CGAL::Monge_via_jet_fitting:
+  //  - PCA of the neighborhood, the fitting basis being the principal
+  //    axes (z = smallest eigenvalue) with origin at the query point
+  //  - preconditioning of the (x,y) coordinates
+  //  - least squares fitting of z = J(x,y)
+  // The degree is a template parameter so that all matrices have a
+  // fixed size (no heap allocation). The normal equations are solved
+  // with a pseudo-inverse to handle degenerate neighborhoods as CGAL's
+  // SVD does. Only the coefficients of degree 0 and 1 are returned:
+  // the height of the jet at the query point (used by smoothing) and
+  // the normal of the jet (used by normal estimation).
+  template <int Degree>
+  struct Jet_fitting
+  {
+    static constexpr int Size = (Degree + 1) * (Degree + 2) / 2;
+
+    typedef Eigen::Matrix<double, Size, Size> Matrix;
+    typedef Eigen::Matrix<double, Size, 1> Vector;
+
+    // Neighbors are given as separate x/y/z arrays. Writes the
+    // projection of p0 on the jet and the normal of the jet at this
+    // point (both in world coordinates).
+    static void fit (const double* x, const double* y, const double* z, std::size_t n,
+                     const double p0[3], double projection[3], double normal[3])
+    {
+      double centroid[3], cov[6], values[3], axes[9];
+      compute_covariance (x, y, z, n, centroid, cov);
+      symmetric_eigen_3 (cov, values, axes);
+
+      // Fitting basis: (e0, e1) tangent, e2 normal
+      const double* e2 = axes;
+      const double* e1 = axes + 3;
+      const double* e0 = axes + 6;
+
+      double precond = 0.;
+      for (std::size_t i = 0; i < n; ++ i)
+      {
+        const double d[3] = { x[i] - p0[0], y[i] - p0[1], z[i] - p0[2] };
+        precond += std::fabs (d[0] * e0[0] + d[1] * e0[1] + d[2] * e0[2])
+          + std::fabs (d[0] * e1[0] + d[1] * e1[1] + d[2] * e1[2]);
+      }
+      precond /= 2. * n;
+      if (precond == 0.)
+        precond = 1.;
+
+      Matrix M = Matrix::Zero();
+      Vector b = Vector::Zero();
+      Vector m;
+      for (std::size_t i = 0; i < n; ++ i)
+      {
+        const double d[3] = { x[i] - p0[0], y[i] - p0[1], z[i] - p0[2] };
+        const double u = (d[0] * e0[0] + d[1] * e0[1] + d[2] * e0[2]) / precond;
+        const double v = (d[0] * e1[0] + d[1] * e1[1] + d[2] * e1[2]) / precond;
+        const double h = d[0] * e2[0] + d[1] * e2[1] + d[2] * e2[2];
+
+        double pu[Degree + 1], pv[Degree + 1];
+        pu[0] = pv[0] = 1.;
+        for (int j = 1; j <= Degree; ++ j)
+        {
+          pu[j] = pu[j-1] * u;
+          pv[j] = pv[j-1] * v;
+        }
+
+        // Monomials by increasing degree: 1, u, v, u2, uv, v2, ...
+        int k = 0;
+        for (int deg = 0; deg <= Degree; ++ deg)
+          for (int j = 0; j <= deg; ++ j)
+            m[k ++] = pu[deg - j] * pv[j];
+
+        M.template selfadjointView<Eigen::Lower>().rankUpdate (m);
+        b += h * m;
+      }
+
+      // Pseudo-inverse solution
+      Eigen::SelfAdjointEigenSolver<Matrix> solver (M.template selfadjointView<Eigen::Lower>());
+      const Vector& l = solver.eigenvalues();
+      const double threshold = l.cwiseAbs().maxCoeff() * Size * 1e-12;
+      Vector proj = solver.eigenvectors().transpose() * b;
+      for (int i = 0; i < Size; ++ i)
+        proj[i] = (std::fabs (l[i]) > threshold ? proj[i] / l[i] : 0.);
+      const Vector c = solver.eigenvectors() * proj;
+
+      const double a0 = c[0];
+      const double a1 = (Degree > 0 ? c[1] / precond : 0.);
+      const double a2 = (Degree > 0 ? c[2] / precond : 0.);
+
+      double norm = 0.;
+      for (int j = 0; j < 3; ++ j)
+      {
+        projection[j] = p0[j] + a0 * e2[j];
+        normal[j] = e2[j] - a1 * e0[j] - a2 * e1[j];
+        norm += normal[j] * normal[j];
+      }
+      norm = std::sqrt (norm);
+      for (int j = 0; j < 3; ++ j)
+        normal[j] /= norm;
+    }
+  };
+
+  // Degrees with a fixed-size specialization
+  inline bool jet_fitting_supports (unsigned int degree)
+  {
+    return (degree >= 1 && degree <= 4);
+  }
+
+  // Runtime degree version of Jet_fitting::fit(), for callers that fit
+  // jets one at a time (the degree must be supported)
+  inline void fit_jet (unsigned int degree, const double* x, const double* y, const double* z, std::size_t n,
+                const double p0[3], double projection[3], double normal[3])
+  {
+    switch (degree)
+    {
+    case 1: Jet_fitting<1>::fit (x, y, z, n, p0, projection, normal); break;
+    case 2: Jet_fitting<2>::fit (x, y, z, n, p0, projection, normal); break;
+    case 3: Jet_fitting<3>::fit (x, y, z, n, p0, projection, normal); break;
+    case 4: Jet_fitting<4>::fit (x, y, z, n, p0, projection, normal); break;
+    default: break;
+    }
+  }
+
+  // Fits a jet to the neighborhood of each point. Points are processed
+  // by batches that share one coordinate buffer (allocated once per
+  // batch, not per point), neighbors being gathered as contiguous x/y/z
+  // arrays for the covariance and fitting loops, from a local copy of
+  // the points (see local_copy()). If cancellation is
+  // requested, the remaining batches are skipped (output is not called
+  // for their points).
+  template <int Degree, typename Output>
+  void fit_jets (const Point_set& points, const Neighbor_graph& graph, const Output& output)
+  {
+    const std::size_t batch_size = 256;
+    const std::size_t nb_batches = (points.size() + batch_size - 1) / batch_size;
+
+    First_touch_vector<Point_3> local;
+    CGALApps::local_copy (points, points.point_map(), local);
+
+    Progress progress ("Jet fitting", points.size(), "point");
+    CGALApps::parallel_for
+      (0, nb_batches,
+       [&](std::size_t batch)
+       {
+         if (cancellation_requested())
+           return;
+
+         const std::size_t begin = batch * batch_size;
+         const std::size_t end = (std::min)(points.size(), begin + batch_size);
+
+         std::size_t max_neighbors = 0;
+         for (std::size_t i = begin; i < end; ++ i)
+           max_neighbors = (std::max)(max_neighbors, std::size_t(graph.neighbors_end(i) - graph.neighbors_begin(i)));
+
+         std::vector<double> coords (3 * max_neighbors);
+         double* x = coords.data();
+         double* y = x + max_neighbors;
+         double* z = y + max_neighbors;
+
+         for (std::size_t i = begin; i < end; ++ i)
+         {
+           const std::size_t nb_neighbors = graph.neighbors_end(i) - graph.neighbors_begin(i);
+           for (std::size_t j = 0; j < nb_neighbors; ++ j)
+           {
+             const Point_3& p = local[graph.neighbors_begin(i)[j]];
+             x[j] = p.x();
+             y[j] = p.y();
+             z[j] = p.z();
+           }
+
+           const Point_3& query = local[i];
+           const double p0[3] = { query.x(), query.y(), query.z() };
+           double projection[3], normal[3];
+           Jet_fitting<Degree>::fit (x, y, z, nb_neighbors, p0, projection, normal);
+           output (i, projection, normal);
+         }
+         progress.advance (end - begin);
+       });
+  }
+
+  template <typename Output>
+  void fit_jets (const Point_set& points, const Neighbor_graph& graph, unsigned int degree,
+                 const Output& output)
+  {
+    switch (degree)
+    {
+    case 1: fit_jets<1> (points, graph, output); break;
+    case 2: fit_jets<2> (points, graph, output); break;
+    case 3: fit_jets<3> (points, graph, output); break;
+    case 4: fit_jets<4> (points, graph, output); break;
+    default: break;
+    }
+  }
+
+  // Same result as CGAL::jet_estimate_normals() (unoriented normals)
+  inline void jet_estimate_normals (Point_set& points, const Neighbor_graph& graph, unsigned int degree)
+  {
+    if (!points.has_normal_map())
+      points.add_normal_map();
+
+    fit_jets (points, graph, degree,
+              [&](std::size_t i, const double*, const double* normal)
+              {
+                points.normal(*(points.begin() + i)) = Vector_3 (normal[0], normal[1], normal[2]);
+              });
+  }
+
+  // Same result as CGAL::jet_smooth_point_set(): points are projected
+  // on their jet (all projections are computed before moving points).
+  // If cancelled, points whose jet was not fitted do not move.
+  inline void jet_smooth_point_set (Point_set& points, const Neighbor_graph& graph, unsigned int degree)
+  {
+    First_touch_vector<Point_3> smoothed (points.size());
+    std::vector<char> fitted (points.size(), 0);
+    fit_jets (points, graph, degree,
+              [&](std::size_t i, const double* projection, const double*)
+              {
+                smoothed[i] = Point_3 (projection[0], projection[1], projection[2]);
+                fitted[i] = 1;
+              });
+
+    for (std::size_t i = 0; i < points.size(); ++ i)
+      if (fitted[i])
+        points.point(*(points.begin() + i)) = smoothed[i];
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_JET_FITTING_H
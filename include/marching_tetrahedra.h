@@ -0,0 +1,360 @@
+#ifndef CGALAPPS_MARCHING_TETRAHEDRA_H
+#define CGALAPPS_MARCHING_TETRAHEDRA_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace CGALApps
+{
+
+  // Regular lattice of step h whose point (i, j, k) lies at origin +
+  // (i, j, k) h, cut in blocks of n^3 points: block (a, b, c) owns the
+  // points of indices [a n; (a + 1) n) x [b n; (b + 1) n) x [c n; (c +
+  // 1) n). Indices are non-negative and below 2^index_bits.
+  struct Lattice
+  {
+    enum { index_bits = 20 };
+
+    double origin[3];
+    double h;
+    long n;
+
+    Point_3 point (long i, long j, long k) const
+    {
+      return Point_3 (origin[0] + i * h, origin[1] + j * h, origin[2] + k * h);
+    }
+
+    static std::uint64_t key (long i, long j, long k)
+    {
+      return (std::uint64_t(i) << (2 * index_bits)) | (std::uint64_t(j) << index_bits) | std::uint64_t(k);
+    }
+
+    // True if the point of given key lies on the first or last layer
+    // of its block along an axis
+    bool on_block_boundary (std::uint64_t key) const
+    {
+      for (int j = 0; j < 3; ++ j)
+      {
+        long i = long((key >> ((2 - j) * index_bits)) & ((std::uint64_t(1) << index_bits) - 1)) % n;
+        if (i == 0 || i == n - 1)
+          return true;
+      }
+      return false;
+    }
+  };
+
+  // Zero level set of a block of a lattice. Each vertex lies on a
+  // lattice edge, identified by the key of its lower point times 8
+  // plus its direction (bit j set if the edge goes along axis j), so
+  // that the meshes of neighbor blocks can be welded (see
+  // weld_blocks()).
+  struct Lattice_mesh
+  {
+    std::vector<Point_3> points;
+    std::vector<std::uint64_t> edges;
+    std::vector<Facet> facets;
+    std::unordered_map<std::uint64_t, std::size_t> map; // Edge -> point, while marching
+  };
+
+  // Vertex on the edge between corners a and b of the cube of lower
+  // corner (i, j, k) (see march_cube())
+  inline std::size_t lattice_vertex (const Lattice& lattice, long i, long j, long k, int a, int b,
+                                     const float value[8], Lattice_mesh& mesh)
+  {
+    // Corners of an edge of Kuhn's triangulation are comparable:
+    // the bits of the lower one are a subset of the bits of the other
+    if ((a & b) != a)
+      std::swap (a, b);
+
+    long ai = i + (a & 1), aj = j + ((a >> 1) & 1), ak = k + (a >> 2);
+    std::uint64_t edge = Lattice::key (ai, aj, ak) * 8 + std::uint64_t(a ^ b);
+
+    std::pair<std::unordered_map<std::uint64_t, std::size_t>::iterator, bool>
+      inserted = mesh.map.insert (std::make_pair (edge, mesh.points.size()));
+    if (inserted.second)
+    {
+      double t = value[a] / (double(value[a]) - double(value[b]));
+      Point_3 pa = lattice.point (ai, aj, ak);
+      Point_3 pb = lattice.point (i + (b & 1), j + ((b >> 1) & 1), k + (b >> 2));
+      mesh.points.push_back (Point_3 (pa[0] + t * (pb[0] - pa[0]),
+                                      pa[1] + t * (pb[1] - pa[1]),
+                                      pa[2] + t * (pb[2] - pa[2])));
+      mesh.edges.push_back (edge);
+    }
+    return inserted.first->second;
+  }
+
+  // Parity of the permutation (a, b, c, d) of (0, 1, 2, 3)
+  inline bool odd_permutation (int a, int b, int c, int d)
+  {
+    int p[4] = { a, b, c, d };
+    bool odd = false;
+    for (int x = 0; x < 4; ++ x)
+      for (int y = x + 1; y < 4; ++ y)
+        if (p[x] > p[y])
+          odd = !odd;
+    return odd;
+  }
+
+  // Triangulates the zero level set in the cube of lower corner (i, j,
+  // k), value[b] being the value at corner (i + (b & 1), j + (b >> 1 &
+  // 1), k + (b >> 2)). The cube is split in 6 tetrahedra sharing its
+  // diagonal (Kuhn's triangulation, whose faces match between neighbor
+  // cubes), so the output is manifold. Values are negative inside,
+  // facets are oriented outwards.
+  inline void march_cube (const Lattice& lattice, long i, long j, long k, const float value[8],
+                          Lattice_mesh& mesh)
+  {
+    int nb_negative = 0;
+    for (int b = 0; b < 8; ++ b)
+      if (value[b] < 0.f)
+        ++ nb_negative;
+    if (nb_negative == 0 || nb_negative == 8)
+      return;
+
+    // Axis permutations, and whether they are odd
+    static const int permutations[6][4] = { { 0, 1, 2, 0 }, { 0, 2, 1, 1 }, { 1, 0, 2, 1 },
+                                            { 1, 2, 0, 0 }, { 2, 0, 1, 0 }, { 2, 1, 0, 1 } };
+
+    for (const int* p : permutations)
+    {
+      // Corners of a positively oriented tetrahedron
+      int corner[4] = { 0, 1 << p[0], (1 << p[0]) | (1 << p[1]), 7 };
+      if (p[3])
+        std::swap (corner[1], corner[2]);
+
+      int negative[4], positive[4];
+      int nb_neg = 0, nb_pos = 0;
+      for (int q = 0; q < 4; ++ q)
+        if (value[corner[q]] < 0.f)
+          negative[nb_neg ++] = q;
+        else
+          positive[nb_pos ++] = q;
+      if (nb_neg == 0 || nb_pos == 0)
+        continue;
+
+      auto vertex = [&](int a, int b) -> std::size_t
+      {
+        return lattice_vertex (lattice, i, j, k, corner[a], corner[b], value, mesh);
+      };
+
+      if (nb_neg == 2)
+      {
+        // Quad between the two negative corners a, b and the two
+        // positive ones c, d, oriented from a, b to c, d if (a, b, c,
+        // d) is even
+        int a = negative[0], b = negative[1], c = positive[0], d = positive[1];
+        if (odd_permutation (a, b, c, d))
+          std::swap (c, d);
+        std::size_t ac = vertex (a, c), ad = vertex (a, d), bd = vertex (b, d), bc = vertex (b, c);
+        mesh.facets.push_back (Facet {{ ac, ad, bd }});
+        mesh.facets.push_back (Facet {{ ac, bd, bc }});
+      }
+      else
+      {
+        // Triangle around the lone corner v, facing away from it if
+        // (v, o0, o1, o2) is even
+        int v = (nb_neg == 1 ? negative[0] : positive[0]);
+        int o[3];
+        for (int q = 0, x = 0; q < 4; ++ q)
+          if (q != v)
+            o[x ++] = q;
+        if (odd_permutation (v, o[0], o[1], o[2]) != (nb_neg == 3))
+          std::swap (o[1], o[2]);
+        mesh.facets.push_back (Facet {{ vertex (v, o[0]), vertex (v, o[1]), vertex (v, o[2]) }});
+      }
+    }
+  }
+
+  // Marches the cubes of block whose corners all belong to it.
+  // function is evaluated at the points of the block within r cells
+  // (L-infinity) of the cell of one of points, one slice at a time so
+  // that memory is quadratic in the block size; cubes with a corner
+  // not evaluated are skipped. The values of the first and last layers
+  // of the block are appended to boundary for march_seams(). points
+  // should contain all points within r h of the block.
+  template <typename Function>
+  void march_block (const Lattice& lattice, const std::array<long, 3>& block,
+                    const std::vector<Point_3>& points, long r, const Function& function,
+                    Lattice_mesh& mesh, std::vector<std::pair<std::uint64_t, float> >& boundary)
+  {
+    const long n = lattice.n;
+    const long w = n + 2 * r;
+    const long first[3] = { block[0] * n, block[1] * n, block[2] * n };
+    const float undefined = std::numeric_limits<float>::quiet_NaN();
+
+    // Cells of the points around the block, by slice
+    std::vector<std::array<long, 3> > cells;
+    cells.reserve (points.size());
+    for (const Point_3& p : points)
+    {
+      std::array<long, 3> c;
+      bool inside = true;
+      for (int j = 0; j < 3 && inside; ++ j)
+      {
+        c[j] = long(std::floor ((p[j] - lattice.origin[j]) / lattice.h)) - first[j];
+        inside = (c[j] >= -r && c[j] < n + r);
+      }
+      if (inside)
+        cells.push_back (c);
+    }
+    std::sort (cells.begin(), cells.end(),
+               [](const std::array<long, 3>& a, const std::array<long, 3>& b) { return a[2] < b[2]; });
+
+    std::vector<int> count (w * w, 0);   // Cells within r slices, per (x + r, y + r)
+    std::vector<char> along_x (n * w);    // Cells within r columns, per (x, y + r)
+    std::vector<int> prefix (w + 1, 0);
+    std::vector<float> previous (n * n), current (n * n);
+    std::size_t lo = 0, hi = 0;
+
+    for (long z = 0; z < n; ++ z)
+    {
+      for (; hi < cells.size() && cells[hi][2] <= z + r; ++ hi)
+        ++ count[(cells[hi][0] + r) + w * (cells[hi][1] + r)];
+      for (; lo < hi && cells[lo][2] < z - r; ++ lo)
+        -- count[(cells[lo][0] + r) + w * (cells[lo][1] + r)];
+
+      // Dilation of the occupied cells by r along x, then along y
+      for (long y = 0; y < w; ++ y)
+      {
+        for (long x = 0; x < w; ++ x)
+          prefix[x + 1] = prefix[x] + (count[x + w * y] != 0 ? 1 : 0);
+        for (long x = 0; x < n; ++ x)
+          along_x[x + n * y] = (prefix[x + 2 * r + 1] != prefix[x]);
+      }
+
+      for (long x = 0; x < n; ++ x)
+      {
+        for (long y = 0; y < w; ++ y)
+          prefix[y + 1] = prefix[y] + along_x[x + n * y];
+        for (long y = 0; y < n; ++ y)
+          current[x + n * y] = (prefix[y + 2 * r + 1] != prefix[y] ? 0.f : undefined);
+      }
+
+      for (long y = 0; y < n; ++ y)
+        for (long x = 0; x < n; ++ x)
+        {
+          float& value = current[x + n * y];
+          if (std::isnan (value))
+            continue;
+
+          value = float(function (lattice.point (first[0] + x, first[1] + y, first[2] + z)));
+          if (x == 0 || x == n - 1 || y == 0 || y == n - 1 || z == 0 || z == n - 1)
+            boundary.push_back (std::make_pair (Lattice::key (first[0] + x, first[1] + y, first[2] + z), value));
+        }
+
+      if (z > 0)
+        for (long y = 0; y < n - 1; ++ y)
+          for (long x = 0; x < n - 1; ++ x)
+          {
+            float value[8];
+            bool defined = true;
+            for (int b = 0; b < 8 && defined; ++ b)
+            {
+              const std::vector<float>& slice = ((b >> 2) == 0 ? previous : current);
+              value[b] = slice[(x + (b & 1)) + n * (y + ((b >> 1) & 1))];
+              defined = !std::isnan (value[b]);
+            }
+            if (defined)
+              march_cube (lattice, first[0] + x, first[1] + y, first[2] + z - 1, value, mesh);
+          }
+
+      std::swap (previous, current);
+    }
+
+    std::unordered_map<std::uint64_t, std::size_t>().swap (mesh.map);
+  }
+
+  // Marches the cubes of block with corners in neighbor blocks (lower
+  // corner on the last layer of block along an axis), from the values
+  // of the boundary layers of all blocks (see march_block()). Cubes
+  // with a corner not evaluated are skipped.
+  inline void march_seams (const Lattice& lattice, const std::array<long, 3>& block,
+                           const std::unordered_map<std::uint64_t, float>& boundary, Lattice_mesh& mesh)
+  {
+    const long n = lattice.n;
+    for (long z = 0; z < n; ++ z)
+      for (long y = 0; y < n; ++ y)
+        for (long x = (y == n - 1 || z == n - 1 ? 0 : n - 1); x < n; ++ x)
+        {
+          long i = block[0] * n + x, j = block[1] * n + y, k = block[2] * n + z;
+          float value[8];
+          bool defined = true;
+          for (int b = 0; b < 8 && defined; ++ b)
+          {
+            std::unordered_map<std::uint64_t, float>::const_iterator
+              found = boundary.find (Lattice::key (i + (b & 1), j + ((b >> 1) & 1), k + (b >> 2)));
+            defined = (found != boundary.end());
+            if (defined)
+              value[b] = found->second;
+          }
+          if (defined)
+            march_cube (lattice, i, j, k, value, mesh);
+        }
+
+    std::unordered_map<std::uint64_t, std::size_t>().swap (mesh.map);
+  }
+
+  // Concatenates the meshes of the blocks of lattice in their order
+  // (so the output does not depend on the order they were computed
+  // in), merging the vertices of edges between boundary layers, which
+  // are the only ones several blocks can share. Meshes are freed.
+  inline void weld_blocks (const Lattice& lattice, std::vector<Lattice_mesh>& meshes,
+                           std::vector<Point_3>& points, std::vector<Facet>& facets)
+  {
+    std::size_t nb_points = 0, nb_facets = 0;
+    for (const Lattice_mesh& mesh : meshes)
+    {
+      nb_points += mesh.points.size();
+      nb_facets += mesh.facets.size();
+    }
+    points.reserve (points.size() + nb_points);
+    facets.reserve (facets.size() + nb_facets);
+
+    std::unordered_map<std::uint64_t, std::size_t> shared;
+    std::vector<std::size_t> index;
+    for (Lattice_mesh& mesh : meshes)
+    {
+      index.resize (mesh.points.size());
+      for (std::size_t v = 0; v < mesh.points.size(); ++ v)
+      {
+        std::uint64_t edge = mesh.edges[v];
+        std::uint64_t a = edge >> 3;
+        std::uint64_t b = a + ((edge & 1) << (2 * Lattice::index_bits))
+                            + (((edge >> 1) & 1) << Lattice::index_bits) + ((edge >> 2) & 1);
+
+        if (lattice.on_block_boundary (a) && lattice.on_block_boundary (b))
+        {
+          std::pair<std::unordered_map<std::uint64_t, std::size_t>::iterator, bool>
+            inserted = shared.insert (std::make_pair (edge, points.size()));
+          if (inserted.second)
+            points.push_back (mesh.points[v]);
+          index[v] = inserted.first->second;
+        }
+        else
+        {
+          index[v] = points.size();
+          points.push_back (mesh.points[v]);
+        }
+      }
+
+      for (const Facet& f : mesh.facets)
+        facets.push_back (Facet {{ index[f[0]], index[f[1]], index[f[2]] }});
+
+      std::vector<Point_3>().swap (mesh.points);
+      std::vector<std::uint64_t>().swap (mesh.edges);
+      std::vector<Facet>().swap (mesh.facets);
+    }
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_MARCHING_TETRAHEDRA_H
@@ -0,0 +1,258 @@
+#ifndef CGALAPPS_NEIGHBOR_SEARCH_H
+#define CGALAPPS_NEIGHBOR_SEARCH_H
+
+#include <CGAL/Search_traits_3.h>
+#include <CGAL/Search_traits_adapter.h>
+#include <CGAL/Orthogonal_k_neighbor_search.h>
+#include <CGAL/Fuzzy_sphere.h>
+
+#include <CGAL/Real_timer.h>
+
+#include <boost/tuple/tuple.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "arena.h"
+#include "bucket_kd_tree.h"
+#include "parallel.h"
+#include "progress.h"
+#include "threads.h"
+
+namespace CGALApps
+{
+
+  // Data structure used for k nearest neighbor queries:
+  //  - KD_TREE: CGAL's k-d tree through the search traits (default)
+  //  - BUCKET_SIMD: bucket k-d tree with the widest distance kernel
+  //    supported by the CPU (see bucket_kd_tree.h)
+  //  - BUCKET_SCALAR: bucket k-d tree with the scalar kernel
+  enum Search_method { KD_TREE, BUCKET_SIMD, BUCKET_SCALAR };
+
+  inline bool search_method_from_string (const std::string& str, Search_method& method)
+  {
+    if (str == "cgal")
+      method = KD_TREE;
+    else if (str == "simd")
+      method = BUCKET_SIMD;
+    else if (str == "scalar")
+      method = BUCKET_SCALAR;
+    else
+      return false;
+    return true;
+  }
+
+  // k-d tree on the indices of a point set. The tree is built
+  // eagerly so that queries can then be run concurrently.
+  class Neighbor_query
+  {
+    typedef CGAL::Search_traits_3<Kernel> Traits_base;
+    typedef CGAL::Search_traits_adapter<typename Point_set::Index,
+                                        typename Point_set::Point_map,
+                                        Traits_base> Tree_traits;
+    typedef CGAL::Orthogonal_k_neighbor_search<Tree_traits> Neighbor_search;
+    typedef typename Neighbor_search::Tree Tree;
+    typedef typename Tree::Splitter Splitter;
+    typedef typename Neighbor_search::Distance Distance;
+    typedef CGAL::Fuzzy_sphere<Tree_traits> Sphere;
+
+    Tree_traits m_traits;
+    Tree m_tree;
+
+  public:
+
+    Neighbor_query (const Point_set& points)
+      : m_traits (points.point_map())
+      , m_tree (points.begin(), points.end(), Splitter(), m_traits)
+    {
+      m_tree.build();
+    }
+
+    // Writes the indices of the k nearest neighbors of query (sorted by
+    // increasing distance, including the query itself if it belongs to
+    // the point set)
+    template <typename OutputIterator>
+    OutputIterator k_neighbors (const Point_3& query, unsigned int k, OutputIterator output) const
+    {
+      Neighbor_search search (m_tree, query, k, 0, true, Distance (m_traits.point_property_map()));
+      for (typename Neighbor_search::iterator it = search.begin(); it != search.end(); ++ it)
+        *(output ++) = it->first;
+      return output;
+    }
+
+    // Writes the indices of all points at distance at most radius of
+    // query (in no particular order)
+    template <typename OutputIterator>
+    OutputIterator neighbors_in_radius (const Point_3& query, double radius, OutputIterator output) const
+    {
+      return m_tree.search (output, Sphere (query, radius, 0., m_traits));
+    }
+  };
+
+  // Position in the point set (0 to size-1) of each index, so that
+  // per-point data can be stored in contiguous arrays
+  inline void point_positions (const Point_set& points, std::vector<std::size_t>& position)
+  {
+    std::size_t max_index = 0;
+    for (typename Point_set::const_iterator it = points.begin(); it != points.end(); ++ it)
+      max_index = (std::max)(max_index, std::size_t(*it));
+
+    position.resize (max_index + 1);
+    for (std::size_t i = 0; i < points.size(); ++ i)
+      position[std::size_t(*(points.begin() + i))] = i;
+  }
+
+  // Copy of a property of all points (in point set order), written by
+  // a parallel loop: the pages of a range of points are placed on the
+  // NUMA node of the thread that copied it, which is likely to process
+  // these points again in the next parallel loops over the point set
+  template <typename T, typename PropertyMap>
+  void local_copy (const Point_set& points, PropertyMap map, First_touch_vector<T>& copy)
+  {
+    copy.resize (points.size());
+    CGALApps::parallel_for
+      (0, points.size(),
+       [&](std::size_t i)
+       {
+         copy[i] = get (map, *(points.begin() + i));
+       });
+  }
+
+  // Per-point neighborhood sizes stored in the `scale_k` property by
+  // cgal_estimate_scale, clamped to [k_min;k_max]. Returns false if the
+  // point set does not have this property.
+  inline bool adaptive_neighborhood_sizes (const Point_set& points, unsigned int k_min, unsigned int k_max,
+                                    std::vector<unsigned int>& sizes)
+  {
+    typename Point_set::Property_map<int> scale_k;
+    bool found;
+    boost::tie (scale_k, found) = points.property_map<int>("scale_k");
+    if (!found)
+      return false;
+
+    sizes.resize (points.size());
+    for (std::size_t i = 0; i < points.size(); ++ i)
+      sizes[i] = (std::min)(k_max, (std::max)(k_min, (unsigned int)((std::max)(0, scale_k[*(points.begin() + i)]))));
+    return true;
+  }
+
+  // k nearest neighbors of all points of a point set, computed once in
+  // parallel and stored contiguously so that they can be reused by
+  // several passes of an algorithm. Neighbors are given as positions
+  // in the point set (0 to size-1), including the point itself. The
+  // neighbor array is first written by the parallel queries, so that
+  // its pages are local to the threads that read them back.
+  class Neighbor_graph
+  {
+    std::vector<std::size_t> m_offsets;
+    First_touch_vector<std::size_t> m_neighbors;
+    double m_search_time;
+    const char* m_kernel_name;
+
+  public:
+
+    Neighbor_graph (const Point_set& points, unsigned int k, Search_method method = KD_TREE)
+    {
+      build (points, std::vector<unsigned int> (points.size(), k), method);
+    }
+
+    // Adaptive version: sizes[i] neighbors for the i-th point
+    Neighbor_graph (const Point_set& points, const std::vector<unsigned int>& sizes,
+                    Search_method method = KD_TREE)
+    {
+      build (points, sizes, method);
+    }
+
+    std::size_t size() const { return m_offsets.size() - 1; }
+
+    // Time spent building the search structure and querying it
+    double search_time() const { return m_search_time; }
+
+    // Displays the query throughput per thread and the allocations of
+    // query temporaries
+    void print_statistics (std::ostream& stream) const
+    {
+      stream << size() << " neighbor queries (" << m_kernel_name << ") in " << m_search_time << " second(s)";
+      if (m_search_time > 0.)
+        stream << ", " << size() / (m_search_time * CGALApps::nb_threads()) << " queries/s per thread";
+      stream << std::endl;
+      print_arena_statistics (stream, size());
+    }
+
+    const std::size_t* neighbors_begin (std::size_t i) const { return m_neighbors.data() + m_offsets[i]; }
+    const std::size_t* neighbors_end (std::size_t i) const { return m_neighbors.data() + m_offsets[i+1]; }
+
+  private:
+
+    void build (const Point_set& points, const std::vector<unsigned int>& sizes, Search_method method)
+    {
+      m_offsets.resize (points.size() + 1);
+      m_offsets[0] = 0;
+      for (std::size_t i = 0; i < points.size(); ++ i)
+        m_offsets[i+1] = m_offsets[i] + sizes[i];
+      m_neighbors.resize (m_offsets.back());
+
+      CGAL::Real_timer t;
+      t.start();
+
+      if (method == KD_TREE)
+      {
+        m_kernel_name = "cgal";
+        build_with_kd_tree (points, sizes);
+      }
+      else
+      {
+        Bucket_kd_tree tree (points, method == BUCKET_SIMD);
+        m_kernel_name = tree.kernel_name();
+
+        // Queries are run in the order of the leaves for locality
+        std::vector<std::size_t> order = tree.spatial_order();
+        Progress progress ("Neighbor search", order.size(), "query");
+        CGALApps::parallel_for
+          (0, order.size(),
+           [&](std::size_t o)
+           {
+             std::size_t i = order[o];
+             std::size_t* begin = m_neighbors.data() + m_offsets[i];
+             std::size_t* end = tree.k_neighbors (points.point(*(points.begin() + i)), sizes[i], begin);
+
+             // Less than k neighbors if the point set is small
+             std::fill (end, begin + sizes[i], i);
+           }, progress);
+      }
+
+      m_search_time = t.time();
+    }
+
+    void build_with_kd_tree (const Point_set& points, const std::vector<unsigned int>& sizes)
+    {
+      std::vector<std::size_t> position;
+      point_positions (points, position);
+
+      Neighbor_query query (points);
+      Progress progress ("Neighbor search", points.size(), "query");
+      CGALApps::parallel_for
+        (0, points.size(),
+         [&](std::size_t i)
+         {
+           Monotonic_arena& arena = thread_arena();
+           Arena_scope scope (arena);
+           Arena_vector<typename Point_set::Index> neighbors (arena);
+           neighbors.reserve (sizes[i]);
+           query.k_neighbors (points.point(*(points.begin() + i)), sizes[i], std::back_inserter (neighbors));
+
+           // Less than k neighbors if the point set is small
+           std::size_t j = 0;
+           for (; j < neighbors.size(); ++ j)
+             m_neighbors[m_offsets[i] + j] = position[std::size_t(neighbors[j])];
+           for (; j < sizes[i]; ++ j)
+             m_neighbors[m_offsets[i] + j] = i;
+         }, progress);
+    }
+  };
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_NEIGHBOR_SEARCH_H
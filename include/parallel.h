@@ -0,0 +1,93 @@
+#ifndef CGALAPPS_PARALLEL_H
+#define CGALAPPS_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+
+#ifdef CGAL_LINKED_WITH_TBB
+#include <tbb/blocked_range.h>
+#include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+#include <tbb/task_arena.h>
+#endif
+
+#include "progress.h"
+
+namespace CGALApps
+{
+
+// Number of threads used by parallel algorithms (all cores unless
+// limited by --threads, see threads.h)
+inline std::size_t nb_threads()
+{
+#ifdef CGAL_LINKED_WITH_TBB
+  return (std::min)(std::size_t(tbb::this_task_arena::max_concurrency()),
+                    tbb::global_control::active_value (tbb::global_control::max_allowed_parallelism));
+#else
+  return 1;
+#endif
+}
+
+// Calls f(i) for all i in [begin;end), in parallel if TBB is available
+template <typename Function>
+void parallel_for (std::size_t begin, std::size_t end, const Function& f)
+{
+#ifdef CGAL_LINKED_WITH_TBB
+  tbb::parallel_for (tbb::blocked_range<std::size_t>(begin, end),
+                     [&](const tbb::blocked_range<std::size_t>& r)
+                     {
+                       for (std::size_t i = r.begin(); i != r.end(); ++ i)
+                         f(i);
+                     });
+#else
+  for (std::size_t i = begin; i < end; ++ i)
+    f(i);
+#endif
+}
+
+// Same as parallel_for(), reporting the calls to progress (once per
+// range, not per call, to limit contention)
+template <typename Function>
+void parallel_for (std::size_t begin, std::size_t end, const Function& f, Progress& progress)
+{
+#ifdef CGAL_LINKED_WITH_TBB
+  tbb::parallel_for (tbb::blocked_range<std::size_t>(begin, end),
+                     [&](const tbb::blocked_range<std::size_t>& r)
+                     {
+                       for (std::size_t i = r.begin(); i != r.end(); ++ i)
+                         f(i);
+                       progress.advance (r.size());
+                     });
+#else
+  for (std::size_t i = begin; i < end; ++ i)
+  {
+    f(i);
+    progress.advance();
+  }
+#endif
+}
+
+template <typename RandomAccessIterator, typename Compare>
+void parallel_sort (RandomAccessIterator begin, RandomAccessIterator end, const Compare& comp)
+{
+#ifdef CGAL_LINKED_WITH_TBB
+  tbb::parallel_sort (begin, end, comp);
+#else
+  std::sort (begin, end, comp);
+#endif
+}
+
+template <typename RandomAccessIterator>
+void parallel_sort (RandomAccessIterator begin, RandomAccessIterator end)
+{
+#ifdef CGAL_LINKED_WITH_TBB
+  tbb::parallel_sort (begin, end);
+#else
+  std::sort (begin, end);
+#endif
+}
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_PARALLEL_H
@@ -0,0 +1,54 @@
+#ifndef CGALAPPS_PCA_ESTIMATE_NORMALS_H
+#define CGALAPPS_PCA_ESTIMATE_NORMALS_H
+
+#include "types.h"
+#include "arena.h"
+#include "covariance.h"
+#include "neighbor_search.h"
+#include "parallel.h"
+
+namespace CGALApps
+{
+
+  // Same result as CGAL::pca_estimate_normals() (unoriented normal of
+  // the least squares plane of the nearest neighbors), but using the
+  // closed-form covariance kernel instead of a generic diagonalization
+  inline void pca_estimate_normals (Point_set& points, const Neighbor_graph& graph)
+  {
+    if (!points.has_normal_map())
+      points.add_normal_map();
+
+    First_touch_vector<Point_3> local;
+    CGALApps::local_copy (points, points.point_map(), local);
+
+    CGALApps::parallel_for
+      (0, points.size(),
+       [&](std::size_t i)
+       {
+         const std::size_t nb_neighbors = graph.neighbors_end(i) - graph.neighbors_begin(i);
+
+         // Coordinates are a temporary of the calling thread's arena
+         Monotonic_arena& arena = thread_arena();
+         Arena_scope scope (arena);
+         Arena_vector<double> coords (3 * nb_neighbors, 0., arena);
+         double* x = coords.data();
+         double* y = x + nb_neighbors;
+         double* z = y + nb_neighbors;
+         for (std::size_t j = 0; j < nb_neighbors; ++ j)
+         {
+           const Point_3& p = local[graph.neighbors_begin(i)[j]];
+           x[j] = p.x();
+           y[j] = p.y();
+           z[j] = p.z();
+         }
+
+         double centroid[3], cov[6], normal[3];
+         CGALApps::compute_covariance (x, y, z, nb_neighbors, centroid, cov);
+         CGALApps::symmetric_eigen_3_smallest (cov, normal);
+         points.normal(*(points.begin() + i)) = Vector_3 (normal[0], normal[1], normal[2]);
+       });
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_PCA_ESTIMATE_NORMALS_H
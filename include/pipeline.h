@@ -0,0 +1,176 @@
+#ifndef CGALAPPS_PIPELINE_H
+#define CGALAPPS_PIPELINE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+
+namespace CGALApps
+{
+
+  // FIFO of at most capacity elements shared by threads: push() waits
+  // while the queue is full and pop() while it is empty. Once closed,
+  // push() fails and pop() fails when the queue is empty.
+  template <typename T>
+  class Bounded_queue
+  {
+    std::deque<T> m_queue;
+    std::size_t m_capacity;
+    bool m_closed;
+    std::mutex m_mutex;
+    std::condition_variable m_not_full;
+    std::condition_variable m_not_empty;
+
+  public:
+
+    Bounded_queue (std::size_t capacity)
+      : m_capacity (capacity), m_closed (false)
+    { }
+
+    bool push (T&& t)
+    {
+      std::unique_lock<std::mutex> lock (m_mutex);
+      m_not_full.wait (lock, [&]() { return m_closed || m_queue.size() < m_capacity; });
+      if (m_closed)
+        return false;
+      m_queue.push_back (std::move (t));
+      m_not_empty.notify_one();
+      return true;
+    }
+
+    bool pop (T& t)
+    {
+      std::unique_lock<std::mutex> lock (m_mutex);
+      m_not_empty.wait (lock, [&]() { return m_closed || !m_queue.empty(); });
+      return pop_front (t);
+    }
+
+    // Same as pop() without waiting
+    bool try_pop (T& t)
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      return pop_front (t);
+    }
+
+    void close()
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_closed = true;
+      m_not_full.notify_all();
+      m_not_empty.notify_all();
+    }
+
+  private:
+
+    bool pop_front (T& t)
+    {
+      if (m_queue.empty())
+        return false;
+      t = std::move (m_queue.front());
+      m_queue.pop_front();
+      m_not_full.notify_one();
+      return true;
+    }
+  };
+
+  // Runs the three stages of a pipeline concurrently: read(batch) on a
+  // reader thread until it returns false, compute(group) on the
+  // calling thread, on groups of up to group_size batches (in parallel
+  // inside compute, see parallel_for()), and write(batch) on a writer
+  // thread, in the order batches were read. Stages are connected by
+  // queues of depth groups, so that at most a few groups are in memory
+  // while reading, computing and writing overlap. An exception thrown
+  // by a stage stops the pipeline and is rethrown.
+  template <typename Batch, typename Read, typename Compute, typename Write>
+  void run_pipeline (const Read& read, const Compute& compute, const Write& write,
+                     std::size_t group_size = nb_threads(), std::size_t depth = 2)
+  {
+    Bounded_queue<Batch> input (group_size * depth);
+    Bounded_queue<Batch> output (group_size * depth);
+
+    std::exception_ptr reader_error, writer_error;
+
+    std::thread reader ([&]()
+    {
+      try
+      {
+        Batch batch;
+        while (read (batch))
+        {
+          if (!input.push (std::move (batch)))
+            break;
+          batch = Batch();
+        }
+      }
+      catch (...)
+      {
+        reader_error = std::current_exception();
+      }
+      input.close();
+    });
+
+    std::thread writer ([&]()
+    {
+      try
+      {
+        Batch batch;
+        while (output.pop (batch))
+          write (batch);
+      }
+      catch (...)
+      {
+        writer_error = std::current_exception();
+        // Unblocks the other stages
+        output.close();
+        input.close();
+      }
+    });
+
+    std::exception_ptr compute_error;
+    try
+    {
+      std::vector<Batch> group;
+      Batch batch;
+      bool open = true;
+      while (open && input.pop (batch))
+      {
+        // Batches already read are grouped, without waiting for more
+        group.clear();
+        group.push_back (std::move (batch));
+        while (group.size() < group_size && input.try_pop (batch))
+          group.push_back (std::move (batch));
+
+        compute (group);
+
+        for (std::size_t i = 0; open && i < group.size(); ++ i)
+          open = output.push (std::move (group[i]));
+      }
+    }
+    catch (...)
+    {
+      compute_error = std::current_exception();
+      input.close();
+    }
+    output.close();
+
+    reader.join();
+    writer.join();
+
+    if (compute_error)
+      std::rethrow_exception (compute_error);
+    if (reader_error)
+      std::rethrow_exception (reader_error);
+    if (writer_error)
+      std::rethrow_exception (writer_error);
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_PIPELINE_H
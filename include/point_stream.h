@@ -0,0 +1,447 @@
+#ifndef CGALAPPS_POINT_STREAM_H
+#define CGALAPPS_POINT_STREAM_H
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "io.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "progress.h"
+#include "types.h"
+
+namespace CGALApps
+{
+
+  enum Point_stream_format
+  {
+    XYZ_STREAM,
+    PLY_ASCII_STREAM,
+    PLY_BINARY_STREAM
+  };
+
+  // Batch of points going through a pipeline (see run_pipeline())
+  struct Point_batch
+  {
+    std::size_t number = 0;      // Position of the batch in the input
+    std::size_t first_line = 0;  // Line of the input where the batch starts
+    std::size_t first_index = 0; // Index of the first point in the input
+    std::size_t size = 0;        // Number of points
+    std::string text;            // Whole lines of the input
+    std::vector<double> values;  // x y z nx ny nz of each point
+    bool normals = false;        // True if a point of the batch has a normal
+    std::string output;          // Formatted points
+    std::size_t nb_written = 0;  // Number of points in output
+  };
+
+  // Reads a text file by blocks of about block_size bytes cut at line
+  // breaks. Reading stops early if cancellation is requested.
+  class Line_block_reader
+  {
+    std::ifstream m_file;
+    std::string m_rest; // Beginning of the line cut by the last block
+    std::size_t m_block_size;
+    std::size_t m_number;
+    std::size_t m_line;
+    Progress m_progress;
+
+  public:
+
+    Line_block_reader (const std::string& filename, std::size_t block_size = (1 << 20))
+      : m_file (filename.c_str(), std::ios::binary), m_block_size (block_size)
+      , m_number (0), m_line (1)
+      , m_progress ("Streaming", (m_file ? std::size_t(boost::filesystem::file_size (filename)) : 0), "byte")
+    {
+      if (!m_file)
+        throw std::runtime_error ("cannot open " + filename);
+    }
+
+    bool next (Point_batch& batch)
+    {
+      if (cancellation_requested())
+        return false;
+
+      batch.text.swap (m_rest);
+      m_rest.clear();
+
+      // Lines longer than a block make the batch grow until a line
+      // break or the end of the file is found
+      while (m_file)
+      {
+        std::size_t size = batch.text.size();
+        batch.text.resize (size + m_block_size);
+        m_file.read (&batch.text[size], m_block_size);
+        batch.text.resize (size + std::size_t(m_file.gcount()));
+        m_progress.advance (std::size_t(m_file.gcount()));
+
+        std::size_t end = batch.text.find_last_of ('\n');
+        if (m_file && end != std::string::npos)
+        {
+          m_rest.assign (batch.text, end + 1, std::string::npos);
+          batch.text.resize (end + 1);
+          break;
+        }
+      }
+
+      if (batch.text.empty())
+        return false;
+
+      batch.number = m_number ++;
+      batch.first_line = m_line;
+      m_line += std::size_t(std::count (batch.text.begin(), batch.text.end(), '\n'));
+      return true;
+    }
+  };
+
+  // Parses the lines of an XYZ batch (x y z, optionally followed by nx
+  // ny nz) like CGAL's reader: empty lines, lines starting with # and
+  // a first line holding the number of points are skipped
+  inline void parse_xyz_batch (Point_batch& batch)
+  {
+    batch.values.clear();
+    batch.normals = false;
+
+    const char* line = batch.text.c_str();
+    const char* end_of_text = line + batch.text.size();
+    bool first_line = (batch.number == 0);
+
+    for (std::size_t line_number = batch.first_line; line < end_of_text; ++ line_number)
+    {
+      const char* eol = static_cast<const char*>(std::memchr (line, '\n', std::size_t(end_of_text - line)));
+      if (eol == nullptr)
+        eol = end_of_text;
+
+      const char* first = line;
+      while (first != eol && std::isspace (static_cast<unsigned char>(*first)))
+        ++ first;
+
+      if (first != eol && *first != '#')
+      {
+        // strtod() skips line breaks: values ending after eol belong
+        // to the next line
+        double v[6];
+        std::size_t nb = 0;
+        const char* p = first;
+        for (; nb < 6; ++ nb)
+        {
+          char* end;
+          v[nb] = std::strtod (p, &end);
+          if (end == p || end > eol)
+            break;
+          p = end;
+        }
+
+        if (nb == 3 || nb == 6)
+        {
+          if (nb == 3)
+            v[3] = v[4] = v[5] = 0.;
+          else
+            batch.normals = true;
+          batch.values.insert (batch.values.end(), v, v + 6);
+        }
+        else if (!(nb == 1 && first_line))
+          throw std::runtime_error ("invalid point at line " + std::to_string (line_number));
+
+        first_line = false;
+      }
+
+      line = eol + 1;
+    }
+
+    batch.size = batch.values.size() / 6;
+  }
+
+  // Formats the points of batch for which keep(i) is true, i being
+  // the index of the point in the input, with normals if normals is
+  // true. ASCII formats use the precision of CGAL's writers.
+  template <typename Keep>
+  void format_batch (Point_batch& batch, Point_stream_format format, bool normals, const Keep& keep)
+  {
+    batch.output.clear();
+    batch.nb_written = 0;
+
+    const std::size_t nb_values = (normals ? 6 : 3);
+    const char* line_format;
+    if (format == XYZ_STREAM)
+      line_format = (normals ? "%g %g %g %g %g %g\n" : "%g %g %g\n");
+    else
+      line_format = (normals ? "%.17g %.17g %.17g %.17g %.17g %.17g\n" : "%.17g %.17g %.17g\n");
+
+    char line[256];
+    for (std::size_t i = 0; i < batch.size; ++ i)
+    {
+      if (!keep (batch.first_index + i))
+        continue;
+
+      const double* v = &batch.values[6 * i];
+      if (format == PLY_BINARY_STREAM)
+        batch.output.append (reinterpret_cast<const char*>(v), nb_values * sizeof(double));
+      else
+      {
+        int size = std::snprintf (line, sizeof(line), line_format, v[0], v[1], v[2], v[3], v[4], v[5]);
+        batch.output.append (line, std::size_t(size));
+      }
+      ++ batch.nb_written;
+    }
+  }
+
+  // Writes formatted batches to a file (stdout if filename is empty).
+  // The PLY vertex count is written in the header if known, otherwise
+  // it is reserved and set by finish(), which requires a file.
+  class Point_stream_writer
+  {
+    std::ofstream m_file;
+    std::ostream* m_stream;
+    Point_stream_format m_format;
+    bool m_header;
+    std::streampos m_count_position;
+    std::size_t m_count;
+
+  public:
+
+    static const std::size_t unknown_count = std::size_t(-1);
+
+    Point_stream_writer (const std::string& filename, Point_stream_format format)
+      : m_stream (&std::cout), m_format (format), m_header (false), m_count_position (-1), m_count (0)
+    {
+      if (filename != "")
+      {
+        m_file.open (filename.c_str(), std::ios::binary);
+        if (!m_file)
+          throw std::runtime_error ("cannot write " + filename);
+        m_stream = &m_file;
+      }
+    }
+
+    bool header_written() const { return m_header; }
+
+    void write_header (bool normals, std::size_t count = unknown_count)
+    {
+      m_header = true;
+      if (m_format == XYZ_STREAM)
+        return;
+
+      std::uint16_t one = 1;
+      unsigned char first_byte;
+      std::memcpy (&first_byte, &one, 1);
+
+      *m_stream << "ply" << std::endl
+                << "format " << (m_format == PLY_ASCII_STREAM ? "ascii"
+                                 : first_byte == 1 ? "binary_little_endian" : "binary_big_endian")
+                << " 1.0" << std::endl
+                << "comment Generated by the CGAL library" << std::endl
+                << "element vertex ";
+      if (count == unknown_count)
+      {
+        // Space-padded so that any count fits when it is set (leading
+        // zeros would be read as octal by strtol-based readers)
+        m_count_position = m_stream->tellp();
+        *m_stream << std::string (20, ' ');
+      }
+      else
+        *m_stream << count;
+      *m_stream << std::endl
+                << "property double x" << std::endl
+                << "property double y" << std::endl
+                << "property double z" << std::endl;
+      if (normals)
+        *m_stream << "property double nx" << std::endl
+                  << "property double ny" << std::endl
+                  << "property double nz" << std::endl;
+      *m_stream << "end_header" << std::endl;
+    }
+
+    void write (const Point_batch& batch)
+    {
+      m_stream->write (batch.output.data(), std::streamsize(batch.output.size()));
+      m_count += batch.nb_written;
+    }
+
+    // Returns the number of points written
+    std::size_t finish()
+    {
+      if (!m_header)
+        write_header (false);
+
+      if (m_count_position != std::streampos(-1))
+      {
+        m_stream->seekp (m_count_position);
+        *m_stream << m_count;
+        m_stream->seekp (0, std::ios::end);
+      }
+      m_stream->flush();
+      return m_count;
+    }
+  };
+
+  // Whether stream_xyz_points() can be used: XYZ input file, and output
+  // file for PLY formats (the vertex count is written last)
+  inline bool can_stream_xyz_points (const std::string& ifilename, const std::string& ofilename,
+                                     Point_stream_format format)
+  {
+    return extension_of_file_is (ifilename, "xyz") && (format == XYZ_STREAM || ofilename != "");
+  }
+
+  struct Stream_statistics
+  {
+    std::size_t nb_read = 0;
+    std::size_t nb_written = 0;
+  };
+
+  // Copies the points of the XYZ file ifilename for which keep(i) is
+  // true (i being the index of the point in the input) to ofilename.
+  // Lines are read, parsed and formatted, and written concurrently by
+  // batches (see run_pipeline()): the wall time approaches the longest
+  // of the three instead of their sum and the point set is never in
+  // memory. Normals are written if the first batch has some, later
+  // batches with points should agree.
+  template <typename Keep>
+  Stream_statistics stream_xyz_points (const std::string& ifilename, const std::string& ofilename,
+                                       Point_stream_format format, const Keep& keep)
+  {
+    Line_block_reader reader (ifilename);
+    Point_stream_writer writer (ofilename, format);
+
+    Stream_statistics out;
+    bool normals = false;
+
+    run_pipeline<Point_batch>
+      ([&](Point_batch& batch) -> bool
+       {
+         return reader.next (batch);
+       },
+       [&](std::vector<Point_batch>& group)
+       {
+         CGALApps::parallel_for (0, group.size(), [&](std::size_t i) { parse_xyz_batch (group[i]); });
+
+         // Indices of the points in the input, known once the
+         // previous batches are parsed
+         for (Point_batch& batch : group)
+         {
+           if (batch.number == 0)
+             normals = batch.normals;
+           else if (batch.size != 0 && batch.normals != normals)
+             throw std::runtime_error ("inconsistent normals at line " + std::to_string (batch.first_line));
+           batch.first_index = out.nb_read;
+           out.nb_read += batch.size;
+         }
+
+         CGALApps::parallel_for (0, group.size(),
+                                 [&](std::size_t i) { format_batch (group[i], format, normals, keep); });
+       },
+       [&](Point_batch& batch)
+       {
+         if (!writer.header_written())
+           writer.write_header (normals);
+         writer.write (batch);
+       });
+
+    out.nb_written = writer.finish();
+    return out;
+  }
+
+  // Same as read_point_set() for XYZ files, blocks of lines being
+  // parsed in parallel while the next ones are read. Normals are read
+  // if the first batch has some, later batches with points should
+  // agree.
+  inline void read_xyz_point_set_pipelined (const std::string& filename, Point_set& points)
+  {
+    Line_block_reader reader (filename);
+
+    run_pipeline<Point_batch>
+      ([&](Point_batch& batch) -> bool
+       {
+         return reader.next (batch);
+       },
+       [&](std::vector<Point_batch>& group)
+       {
+         CGALApps::parallel_for (0, group.size(), [&](std::size_t i) { parse_xyz_batch (group[i]); });
+       },
+       [&](Point_batch& batch)
+       {
+         if (batch.number == 0 && batch.normals)
+           points.add_normal_map();
+         else if (batch.size != 0 && batch.normals != points.has_normal_map())
+           throw std::runtime_error ("inconsistent normals at line " + std::to_string (batch.first_line));
+
+         for (std::size_t i = 0; i < batch.size; ++ i)
+         {
+           const double* v = &batch.values[6 * i];
+           if (points.has_normal_map())
+             points.insert (Point_3 (v[0], v[1], v[2]), Vector_3 (v[3], v[4], v[5]));
+           else
+             points.insert (Point_3 (v[0], v[1], v[2]));
+         }
+       });
+  }
+
+  // Same as write_point_set() (binary PLY) for point sets without other
+  // property than normals, batches of points being formatted in
+  // parallel while the previous ones are written
+  inline void write_point_set_pipelined (const std::string& filename, const Point_set& points,
+                                         std::size_t batch_size = (1 << 16))
+  {
+    Point_stream_writer writer (filename, PLY_BINARY_STREAM);
+    const bool normals = points.has_normal_map();
+    writer.write_header (normals, points.size());
+
+    std::size_t next = 0;
+    std::size_t number = 0;
+
+    run_pipeline<Point_batch>
+      ([&](Point_batch& batch) -> bool
+       {
+         if (next == points.size())
+           return false;
+         batch.number = number ++;
+         batch.first_index = next;
+         batch.size = (std::min)(batch_size, points.size() - next);
+         next += batch.size;
+         return true;
+       },
+       [&](std::vector<Point_batch>& group)
+       {
+         CGALApps::parallel_for
+           (0, group.size(),
+            [&](std::size_t i)
+            {
+              Point_batch& batch = group[i];
+              batch.values.resize (6 * batch.size);
+              for (std::size_t j = 0; j < batch.size; ++ j)
+              {
+                typename Point_set::Index idx = *(points.begin() + batch.first_index + j);
+                const Point_3& p = points.point (idx);
+                double* v = &batch.values[6 * j];
+                v[0] = p.x(); v[1] = p.y(); v[2] = p.z();
+                if (normals)
+                {
+                  const Vector_3& n = points.normal (idx);
+                  v[3] = n.x(); v[4] = n.y(); v[5] = n.z();
+                }
+              }
+              format_batch (batch, PLY_BINARY_STREAM, normals, [](std::size_t) { return true; });
+            });
+       },
+       [&](Point_batch& batch)
+       {
+         writer.write (batch);
+       });
+
+    writer.finish();
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_POINT_STREAM_H
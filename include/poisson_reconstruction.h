@@ -0,0 +1,329 @@
+#ifndef CGALAPPS_POISSON_RECONSTRUCTION_H
+#define CGALAPPS_POISSON_RECONSTRUCTION_H
+
+#include <CGAL/Poisson_reconstruction_function.h>
+#include <CGAL/Surface_mesh_default_triangulation_3.h>
+#include <CGAL/Surface_mesh_complex_2_in_triangulation_3.h>
+#include <CGAL/Implicit_surface_3.h>
+#include <CGAL/make_surface_mesh.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include "types.h"
+#include "parallel.h"
+#include "progress.h"
+#include "tiling.h"
+#include "marching_tetrahedra.h"
+#include "poisson_solver.h"
+
+namespace CGALApps
+{
+
+  // Indexed triangle mesh stored as flat arrays
+  struct Triangle_soup
+  {
+    std::vector<Point_3> points;
+    std::vector<Facet> facets;
+  };
+
+  // Meshes the zero level set of function (negative at inner_point)
+  // inside the sphere of given radius around inner_point, with the
+  // criteria of CGAL::poisson_surface_reconstruction_delaunay(). The
+  // facets of the meshing complex are written directly to an indexed
+  // soup instead of building a Polyhedron. Like CGAL's
+  // output_surface_facets_to_polyhedron(), orientation is propagated
+  // through the regular edges of the complex; the first facet of each
+  // component is oriented towards increasing values of function
+  // (outwards).
+  template <typename Function>
+  bool mesh_zero_level_set (const Function& function, const Point_3& inner_point, double radius,
+                            double spacing, double sm_angle, double sm_radius, double sm_distance,
+                            Triangle_soup& soup)
+  {
+    typedef CGAL::Surface_mesh_default_triangulation_3 STr;
+    typedef CGAL::Surface_mesh_complex_2_in_triangulation_3<STr> C2t3;
+    typedef CGAL::Implicit_surface_3<Kernel, Function> Surface_3;
+    typedef typename Kernel::Sphere_3 Sphere_3;
+    typedef typename STr::Vertex_handle Vertex_handle;
+    typedef typename C2t3::Facet C2t3_facet;
+    typedef typename C2t3::Edge Edge;
+
+    double sm_sphere_radius = 5.0 * radius;
+    double sm_dichotomy_error = sm_distance * spacing / 1000.0;
+
+    Surface_3 surface (function,
+                       Sphere_3 (inner_point, sm_sphere_radius * sm_sphere_radius),
+                       sm_dichotomy_error / sm_sphere_radius);
+
+    CGAL::Surface_mesh_default_criteria_3<STr> criteria (sm_angle, sm_radius * spacing, sm_distance * spacing);
+
+    STr tr;
+    C2t3 c2t3 (tr);
+    CGAL::make_surface_mesh (c2t3, surface, criteria, CGAL::Manifold_with_boundary_tag());
+
+    if (tr.number_of_vertices() == 0)
+      return false;
+
+    std::unordered_map<Vertex_handle, std::size_t, boost::hash<Vertex_handle> > map;
+    map.reserve (tr.number_of_vertices());
+    std::unordered_set<C2t3_facet, boost::hash<C2t3_facet> > oriented;
+    oriented.reserve (c2t3.number_of_facets());
+    soup.facets.reserve (soup.facets.size() + c2t3.number_of_facets());
+
+    std::vector<C2t3_facet> stack;
+    for (typename C2t3::Facet_iterator it = c2t3.facets_begin(); it != c2t3.facets_end(); ++ it)
+    {
+      if (oriented.count (*it) != 0 || oriented.count (tr.mirror_facet (*it)) != 0)
+        continue;
+
+      // First facet of a component: flip if the implicit function
+      // decreases along its normal
+      C2t3_facet seed = *it;
+      const Point_3& p0 = seed.first->vertex (tr.vertex_triple_index (seed.second, 0))->point();
+      const Point_3& p1 = seed.first->vertex (tr.vertex_triple_index (seed.second, 1))->point();
+      const Point_3& p2 = seed.first->vertex (tr.vertex_triple_index (seed.second, 2))->point();
+      Vector_3 normal = CGAL::cross_product (p1 - p0, p2 - p0);
+      double length = std::sqrt (normal.squared_length());
+      if (length > 0.)
+      {
+        Point_3 centroid = CGAL::centroid (p0, p1, p2);
+        double offset = 0.25 * std::sqrt ((std::min)((std::min)(CGAL::squared_distance (p0, p1),
+                                                                CGAL::squared_distance (p1, p2)),
+                                                     CGAL::squared_distance (p2, p0)));
+        normal = normal * (offset / length);
+        if (function (centroid + normal) < function (centroid - normal))
+          seed = tr.mirror_facet (seed);
+      }
+
+      oriented.insert (seed);
+      stack.push_back (seed);
+      while (!stack.empty())
+      {
+        C2t3_facet f = stack.back();
+        stack.pop_back();
+
+        Facet out;
+        for (int j = 0; j < 3; ++ j)
+        {
+          Vertex_handle v = f.first->vertex (tr.vertex_triple_index (f.second, j));
+          typename std::unordered_map<Vertex_handle, std::size_t, boost::hash<Vertex_handle> >::iterator
+            found = map.insert (std::make_pair (v, soup.points.size())).first;
+          if (found->second == soup.points.size())
+            soup.points.push_back (v->point());
+          out[j] = found->second;
+        }
+        soup.facets.push_back (out);
+
+        // Neighbors through regular edges get the orientation of f,
+        // facets only reachable through singular edges start new
+        // components
+        for (int j = 0; j < 3; ++ j)
+        {
+          Edge e (f.first, tr.vertex_triple_index (f.second, tr.cw (j)),
+                  tr.vertex_triple_index (f.second, tr.ccw (j)));
+          typename C2t3::Face_status status = c2t3.face_status (e);
+          if (status != C2t3::REGULAR)
+            continue;
+
+          C2t3_facet neighbor = c2t3.neighbor (f, j, status);
+          if (oriented.count (neighbor) == 0 && oriented.count (tr.mirror_facet (neighbor)) == 0)
+          {
+            oriented.insert (neighbor);
+            stack.push_back (neighbor);
+          }
+        }
+      }
+    }
+
+    return true;
+  }
+
+  // Positions of the unknowns of the linear system of function, in the
+  // order of the solution vector: CGAL indexes the unconstrained
+  // vertices of the refined triangulation (see
+  // Reconstruction_triangulation_3::index_unconstrained_vertices())
+  template <typename Function>
+  void unknown_positions (Function& function, std::vector<Point_3>& positions)
+  {
+    typedef typename Function::Triangulation Triangulation;
+    Triangulation& tr = function.tr();
+
+    std::size_t nb_unknowns = 0;
+    for (typename Triangulation::Finite_vertices_iterator v = tr.finite_vertices_begin();
+         v != tr.finite_vertices_end(); ++ v)
+      if (!tr.is_constrained (v))
+        ++ nb_unknowns;
+
+    positions.resize (nb_unknowns);
+    for (typename Triangulation::Finite_vertices_iterator v = tr.finite_vertices_begin();
+         v != tr.finite_vertices_end(); ++ v)
+      if (!tr.is_constrained (v) && std::size_t(v->index()) < nb_unknowns)
+        positions[v->index()] = v->point();
+  }
+
+  // Same pipeline as CGAL::poisson_surface_reconstruction_delaunay()
+  // (implicit function, then surface meshing of its zero level set),
+  // see mesh_zero_level_set(). The implicit function is solved with
+  // solver, which gets the positions of the unknowns for its warm
+  // start.
+  template <typename PointInputIterator, typename PointMap, typename NormalMap>
+  bool poisson_reconstruction (PointInputIterator begin, PointInputIterator end,
+                               PointMap point_map, NormalMap normal_map,
+                               double spacing, double sm_angle, double sm_radius, double sm_distance,
+                               Triangle_soup& soup, const Poisson_solver& solver = Poisson_solver())
+  {
+    typedef CGAL::Poisson_reconstruction_function<Kernel> Poisson_reconstruction_function;
+
+    Poisson_reconstruction_function function (begin, end, point_map, normal_map);
+
+    Poisson_solver function_solver = solver;
+    function_solver.set_unknown_positions
+      ([&function](std::vector<Point_3>& positions) { unknown_positions (function, positions); });
+
+    if (!function.compute_implicit_function (function_solver))
+      return false;
+
+    return mesh_zero_level_set (function, function.get_inner_point(),
+                                std::sqrt (function.bounding_sphere().squared_radius()),
+                                spacing, sm_angle, sm_radius, sm_distance, soup);
+  }
+
+  // Poisson reconstruction of cubic tiles, solved and meshed
+  // independently in parallel. The implicit function of a tile uses
+  // the points within margin around it; its zero level set is
+  // extracted inside the tile by marching tetrahedra on a lattice of
+  // step about spacing aligned with the tiles, near the points (within
+  // margin, see march_block()). The function is then freed, so peak
+  // memory depends on the tile size and number of threads, not on the
+  // whole input. The cubes across tiles are meshed afterwards from the
+  // boundary values of both sides, and the meshes are welded along the
+  // shared lattice edges (see march_seams() and weld_blocks()): the
+  // output is one manifold mesh that does not depend on the number of
+  // threads. margin should not exceed tile_size. Tiles do not use the
+  // warm start of solver, their solver statistics are summed in
+  // statistics if given. If cancellation is requested, tiles not
+  // started yet are skipped and the surface has holes there.
+  inline bool tiled_poisson_reconstruction (const Point_set& points, double tile_size, double margin,
+                                            double spacing, Triangle_soup& out, const Poisson_solver& solver,
+                                            bool verbose, Poisson_solver_statistics* statistics = nullptr)
+  {
+    typedef CGAL::Poisson_reconstruction_function<Kernel> Tile_function;
+
+    std::vector<Tile> tiles;
+    CGALApps::compute_tiles (points, tile_size, margin, tiles);
+
+    if (verbose)
+      std::cerr << tiles.size() << " tile(s) used." << std::endl;
+
+    // Lattice whose blocks are the tiles
+    Lattice lattice;
+    lattice.n = (std::max)(1l, long(std::ceil (tile_size / spacing)));
+    lattice.h = tile_size / lattice.n;
+    for (int j = 0; j < 3; ++ j)
+    {
+      lattice.origin[j] = std::numeric_limits<double>::max();
+      for (const Tile& tile : tiles)
+        lattice.origin[j] = (std::min)(lattice.origin[j], tile.min[j]);
+    }
+
+    std::vector<std::array<long, 3> > blocks (tiles.size());
+    long nb_blocks = 0;
+    for (std::size_t i = 0; i < tiles.size(); ++ i)
+      for (int j = 0; j < 3; ++ j)
+      {
+        blocks[i][j] = std::lround ((tiles[i].min[j] - lattice.origin[j]) / tile_size);
+        nb_blocks = (std::max)(nb_blocks, blocks[i][j] + 1);
+      }
+
+    if (nb_blocks * lattice.n >= (1l << Lattice::index_bits))
+    {
+      std::cerr << "Error: too many lattice points per axis (" << nb_blocks * lattice.n
+                << "), spacing is too small." << std::endl;
+      return false;
+    }
+
+    const long r = long(std::floor (margin / lattice.h));
+
+    std::vector<Lattice_mesh> meshes (tiles.size());
+    std::vector<std::vector<std::pair<std::uint64_t, float> > > boundaries (tiles.size());
+    std::vector<Poisson_solver_statistics> tile_statistics (tiles.size());
+    Progress progress ("Poisson reconstruction", tiles.size(), "tile");
+    CGALApps::parallel_for
+      (0, tiles.size(),
+       [&](std::size_t i)
+       {
+         if (cancellation_requested())
+           return;
+
+         Poisson_solver tile_solver = solver;
+         tile_solver.set_warm_start (nullptr);
+         tile_solver.set_progress (false);
+         tile_solver.set_statistics (&(tile_statistics[i]));
+
+         std::vector<Point_3> context;
+         context.reserve (tiles[i].points.size());
+         for (typename Point_set::Index idx : tiles[i].points)
+           context.push_back (points.point(idx));
+
+         Tile_function function (tiles[i].points.begin(), tiles[i].points.end(),
+                                 points.point_map(), points.normal_map());
+         std::vector<typename Point_set::Index>().swap (tiles[i].points);
+
+         if (!function.compute_implicit_function (tile_solver))
+         {
+           if (verbose)
+           {
+             std::ostringstream oss;
+             oss << "Warning: reconstruction of tile " << i << " failed." << std::endl;
+             std::cerr << oss.str();
+           }
+           return;
+         }
+
+         CGALApps::march_block (lattice, blocks[i], context, r, function, meshes[i], boundaries[i]);
+       }, progress);
+
+    if (statistics != nullptr)
+      for (const Poisson_solver_statistics& s : tile_statistics)
+      {
+        statistics->solves += s.solves;
+        statistics->iterations += s.iterations;
+        statistics->residual = (std::max)(statistics->residual, s.residual);
+        statistics->time += s.time;
+      }
+
+    // Cubes across tiles
+    std::size_t nb_values = 0;
+    for (const std::vector<std::pair<std::uint64_t, float> >& b : boundaries)
+      nb_values += b.size();
+    std::unordered_map<std::uint64_t, float> boundary;
+    boundary.reserve (nb_values);
+    for (std::vector<std::pair<std::uint64_t, float> >& b : boundaries)
+    {
+      boundary.insert (b.begin(), b.end());
+      std::vector<std::pair<std::uint64_t, float> >().swap (b);
+    }
+
+    CGALApps::parallel_for (0, tiles.size(),
+                            [&](std::size_t i) { CGALApps::march_seams (lattice, blocks[i], boundary, meshes[i]); });
+
+    out.points.clear();
+    out.facets.clear();
+    CGALApps::weld_blocks (lattice, meshes, out.points, out.facets);
+    return !out.facets.empty();
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_POISSON_RECONSTRUCTION_H
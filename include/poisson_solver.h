@@ -0,0 +1,346 @@
+#ifndef CGALAPPS_POISSON_SOLVER_H
+#define CGALAPPS_POISSON_SOLVER_H
+
+#include <CGAL/Eigen_sparse_matrix.h>
+#include <CGAL/Eigen_vector.h>
+#include <CGAL/Real_timer.h>
+#include <CGAL/Search_traits_3.h>
+#include <CGAL/Search_traits_adapter.h>
+#include <CGAL/Orthogonal_k_neighbor_search.h>
+#include <CGAL/property_map.h>
+
+#include <boost/iterator/counting_iterator.hpp>
+
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <Eigen/IterativeLinearSolvers>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "parallel.h"
+#include "progress.h"
+
+namespace CGALApps
+{
+
+  // Solution of a linear system with the position of each unknown (the
+  // unconstrained vertices of the refined Delaunay triangulation), so
+  // that it can be interpolated at the unknowns of another run
+  struct Poisson_solution
+  {
+    std::vector<Point_3> points;
+    std::vector<double> values;
+  };
+
+  struct Poisson_solver_statistics
+  {
+    std::size_t solves = 0;
+    std::size_t iterations = 0;
+    std::size_t warm_starts = 0;
+    double residual = 0.; // Largest relative residual |Ax-b|/|b|
+    double time = 0.;
+  };
+
+  // Model of CGAL's SparseLinearAlgebraTraits_d concept for
+  // Poisson_reconstruction_function::compute_implicit_function(), with
+  // a selectable Eigen solver:
+  //  - CG: conjugate gradient with diagonal preconditioner (CGAL's default)
+  //  - ICHOL: conjugate gradient with incomplete Cholesky preconditioner
+  //  - LDLT: sparse Cholesky (direct, exact but memory hungry)
+  // If a warm start is set along with the positions of the unknowns,
+  // iterative solvers start from the previous solution interpolated at
+  // these positions, and the warm start is overwritten by the new
+  // solution. Iterative solvers report their progress and stop (the
+  // solve fails) if cancellation is requested.
+  class Poisson_solver
+  {
+  public:
+
+    typedef CGAL::Eigen_sparse_symmetric_matrix<double> Matrix;
+    typedef CGAL::Eigen_vector<double> Vector;
+    typedef double NT;
+
+    enum Type { CG, ICHOL, LDLT };
+
+  private:
+
+    typedef typename Matrix::EigenType EigenMatrix;
+    typedef typename Vector::EigenType EigenVector;
+
+    typedef std::function<void(std::vector<Point_3>&)> Unknown_positions;
+
+    // Inverse squared distance weighting of the previous solution at
+    // the nb_interpolated closest previous unknowns
+    static const unsigned int nb_interpolated = 4;
+
+    Type m_type;
+    double m_tolerance;
+    bool m_progress;
+    Poisson_solution* m_warm_start;
+    Unknown_positions m_unknown_positions;
+    Poisson_solver_statistics* m_statistics;
+
+  public:
+
+    // A negative tolerance keeps Eigen's default
+    Poisson_solver (Type type = CG, double tolerance = -1.)
+      : m_type (type), m_tolerance (tolerance), m_progress (true), m_warm_start (nullptr), m_statistics (nullptr)
+    { }
+
+    static bool type_from_string (const std::string& str, Type& type)
+    {
+      if (str == "cg")
+        type = CG;
+      else if (str == "ichol")
+        type = ICHOL;
+      else if (str == "ldlt")
+        type = LDLT;
+      else
+        return false;
+      return true;
+    }
+
+    // Progress lines are disabled for the concurrent solves of tiles
+    void set_progress (bool progress) { m_progress = progress; }
+    void set_warm_start (Poisson_solution* warm_start) { m_warm_start = warm_start; }
+    // Called at solve time, as the unknowns are only known once the
+    // triangulation is refined (see unknown_positions())
+    void set_unknown_positions (const Unknown_positions& f) { m_unknown_positions = f; }
+    void set_statistics (Poisson_solver_statistics* statistics) { m_statistics = statistics; }
+
+    bool linear_solver (const Matrix& A, const Vector& B, Vector& X, NT& D)
+    {
+      CGAL::Real_timer t;
+      t.start();
+
+      D = 1.;
+      const EigenMatrix& M = A.eigen_object();
+      const EigenVector& b = B;
+      EigenVector& x = X;
+
+      std::vector<Point_3> positions;
+      if (m_warm_start != nullptr && m_unknown_positions)
+        m_unknown_positions (positions);
+      if (positions.size() != std::size_t(x.size()))
+        positions.clear();
+
+      EigenVector guess = EigenVector::Zero (x.size());
+      bool warm_start = (!positions.empty() && !m_warm_start->points.empty());
+      if (warm_start)
+        interpolate (*m_warm_start, positions, guess);
+
+      std::size_t iterations = 0;
+      bool success;
+      if (cancellation_requested())
+        return false;
+
+      if (m_type == LDLT)
+      {
+        Eigen::SimplicialLDLT<EigenMatrix> solver (M);
+        success = (solver.info() == Eigen::Success);
+        if (success)
+        {
+          x = solver.solve (b);
+          success = (solver.info() == Eigen::Success);
+        }
+        warm_start = false;
+      }
+      else if (m_type == ICHOL)
+        success = iterative_solve<Eigen::IncompleteCholesky<double> > (M, b, guess, x, iterations);
+      else
+        success = iterative_solve<Eigen::DiagonalPreconditioner<double> > (M, b, guess, x, iterations);
+
+      if (!success)
+        return false;
+
+      if (m_warm_start != nullptr && !positions.empty())
+      {
+        m_warm_start->points.swap (positions);
+        m_warm_start->values.assign (x.data(), x.data() + x.size());
+      }
+
+      if (m_statistics != nullptr)
+      {
+        // Only the lower triangle of the symmetric matrix is stored
+        double residual = (M.template selfadjointView<Eigen::Lower>() * x - b).norm() / b.norm();
+        ++ m_statistics->solves;
+        m_statistics->iterations += iterations;
+        if (warm_start)
+          ++ m_statistics->warm_starts;
+        m_statistics->residual = (std::max)(m_statistics->residual, residual);
+        m_statistics->time += t.time();
+      }
+
+      return true;
+    }
+
+  private:
+
+    static void interpolate (const Poisson_solution& solution, const std::vector<Point_3>& positions,
+                             EigenVector& guess)
+    {
+      typedef CGAL::Search_traits_3<Kernel> Traits_base;
+      typedef CGAL::Search_traits_adapter<std::size_t,
+                                          CGAL::Pointer_property_map<Point_3>::const_type,
+                                          Traits_base> Tree_traits;
+      typedef CGAL::Orthogonal_k_neighbor_search<Tree_traits> Neighbor_search;
+      typedef typename Neighbor_search::Tree Tree;
+      typedef typename Tree::Splitter Splitter;
+      typedef typename Neighbor_search::Distance Distance;
+
+      Tree_traits traits (CGAL::make_property_map (solution.points));
+      Tree tree (boost::counting_iterator<std::size_t> (0),
+                 boost::counting_iterator<std::size_t> (solution.points.size()),
+                 Splitter(), traits);
+      tree.build();
+
+      CGALApps::parallel_for
+        (0, positions.size(),
+         [&](std::size_t i)
+         {
+           Neighbor_search search (tree, positions[i], nb_interpolated, 0, true,
+                                   Distance (traits.point_property_map()));
+           double sum = 0., weights = 0.;
+           for (typename Neighbor_search::iterator it = search.begin(); it != search.end(); ++ it)
+           {
+             // Unknown unchanged since the previous run
+             if (it->second == 0.)
+             {
+               sum = solution.values[it->first];
+               weights = 1.;
+               break;
+             }
+             sum += solution.values[it->first] / it->second;
+             weights += 1. / it->second;
+           }
+           guess[i] = (weights > 0. ? sum / weights : 0.);
+         });
+    }
+
+    // Preconditioned conjugate gradient, same iterations as
+    // Eigen::ConjugateGradient (on the lower triangle of M), written out
+    // so that progress is reported and cancellation checked at each
+    // iteration without restarting the solve (Eigen only stops after a
+    // number of iterations, and restarts lose the convergence rate).
+    // Progress is the fraction of the residual reduction done, on a log
+    // scale.
+    template <typename Preconditioner>
+    bool iterative_solve (const EigenMatrix& M, const EigenVector& b, const EigenVector& guess,
+                          EigenVector& x, std::size_t& iterations) const
+    {
+      Preconditioner preconditioner;
+      preconditioner.compute (M);
+      if (preconditioner.info() != Eigen::Success)
+        return false;
+
+      const double tolerance = (m_tolerance > 0. ? m_tolerance : Eigen::NumTraits<double>::epsilon());
+      const std::size_t max_iterations = 2 * std::size_t(M.cols()); // Eigen's default
+      iterations = 0;
+
+      x = guess;
+      const double b_norm2 = b.squaredNorm();
+      if (b_norm2 == 0.)
+      {
+        x.setZero();
+        return true;
+      }
+      const double threshold = (std::max)(tolerance * tolerance * b_norm2, (std::numeric_limits<double>::min)());
+
+      EigenVector residual = b - M.template selfadjointView<Eigen::Lower>() * x;
+      double residual_norm2 = residual.squaredNorm();
+      if (residual_norm2 < threshold)
+        return true;
+
+      std::unique_ptr<Progress> progress (m_progress ? new Progress ("Poisson solver") : nullptr);
+      const double log_start = std::log (residual_norm2), log_end = std::log (threshold);
+
+      EigenVector p = preconditioner.solve (residual);
+      EigenVector z (x.size()), tmp (x.size());
+      double abs_new = residual.dot (p);
+      while (iterations < max_iterations)
+      {
+        tmp.noalias() = M.template selfadjointView<Eigen::Lower>() * p;
+        double alpha = abs_new / p.dot (tmp);
+        x += alpha * p;
+        residual -= alpha * tmp;
+        residual_norm2 = residual.squaredNorm();
+        if (residual_norm2 < threshold)
+          return true;
+
+        if (cancellation_requested())
+          return false;
+        if (progress && log_start > log_end)
+          progress->set ((std::min)(1., (log_start - std::log (residual_norm2)) / (log_start - log_end)));
+
+        z = preconditioner.solve (residual);
+        double abs_old = abs_new;
+        abs_new = residual.dot (z);
+        p = z + (abs_new / abs_old) * p;
+        ++ iterations;
+      }
+
+      return false;
+    }
+  };
+
+  // Solutions are stored as raw binary: a header (magic string and
+  // number of unknowns), then the coordinates and value of each
+  // unknown. A file with a wrong header or size is rejected.
+  static const char poisson_solution_magic[] = "CGALAPPS_POISSON_SOLUTION_1";
+
+  inline bool read_poisson_solution (const std::string& filename, Poisson_solution& solution)
+  {
+    std::ifstream f (filename.c_str(), std::ios::binary);
+    char magic[sizeof(poisson_solution_magic)];
+    std::size_t size;
+    if (!f.read (magic, sizeof(magic))
+        || std::memcmp (magic, poisson_solution_magic, sizeof(magic)) != 0
+        || !f.read (reinterpret_cast<char*>(&size), sizeof(std::size_t)))
+      return false;
+
+    std::streamoff header = f.tellg();
+    f.seekg (0, std::ios::end);
+    if (f.tellg() - header != std::streamoff (size * 4 * sizeof(double)))
+      return false;
+    f.seekg (header);
+
+    std::vector<double> data (4 * size);
+    if (!f.read (reinterpret_cast<char*>(data.data()), data.size() * sizeof(double)))
+      return false;
+
+    solution.points.resize (size);
+    solution.values.resize (size);
+    for (std::size_t i = 0; i < size; ++ i)
+    {
+      solution.points[i] = Point_3 (data[4*i], data[4*i + 1], data[4*i + 2]);
+      solution.values[i] = data[4*i + 3];
+    }
+    return true;
+  }
+
+  inline bool write_poisson_solution (const std::string& filename, const Poisson_solution& solution)
+  {
+    std::ofstream f (filename.c_str(), std::ios::binary);
+    std::size_t size = solution.values.size();
+    f.write (poisson_solution_magic, sizeof(poisson_solution_magic));
+    f.write (reinterpret_cast<const char*>(&size), sizeof(std::size_t));
+    for (std::size_t i = 0; i < size; ++ i)
+    {
+      const double record[4] = { solution.points[i].x(), solution.points[i].y(), solution.points[i].z(),
+                                 solution.values[i] };
+      f.write (reinterpret_cast<const char*>(record), sizeof(record));
+    }
+    return bool(f);
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_POISSON_SOLVER_H
@@ -0,0 +1,160 @@
+#ifndef CGALAPPS_PROGRESS_H
+#define CGALAPPS_PROGRESS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <csignal>
+#include <mutex>
+#include <string>
+
+#include <signal.h>
+#include <unistd.h>
+
+namespace CGALApps
+{
+
+  // Set by the first SIGTERM or SIGINT (see install_cancellation_handler())
+  inline std::atomic<bool>& cancellation_flag()
+  {
+    static std::atomic<bool> flag (false);
+    return flag;
+  }
+
+  inline bool cancellation_requested()
+  {
+    return cancellation_flag().load (std::memory_order_relaxed);
+  }
+
+  inline void cancellation_handler (int signal)
+  {
+    // A second signal terminates the process as usual
+    if (cancellation_flag().exchange (true))
+    {
+      std::signal (signal, SIG_DFL);
+      std::raise (signal);
+    }
+  }
+
+  // Turns SIGTERM and SIGINT into a cancellation request: the loops and
+  // CGAL callbacks that check it stop early, and the app writes the
+  // (partial) result it has instead of dying. Only installed by apps
+  // whose operations check the request, the others keep the default
+  // action.
+  inline void install_cancellation_handler()
+  {
+    cancellation_flag(); // Initialized outside of the handler
+
+    struct sigaction action;
+    action.sa_handler = cancellation_handler;
+    sigemptyset (&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction (SIGTERM, &action, nullptr);
+    sigaction (SIGINT, &action, nullptr);
+  }
+
+  // File descriptor receiving progress lines, -1 if disabled (see the
+  // --progress option)
+  inline int& progress_output()
+  {
+    static int fd = -1;
+    return fd;
+  }
+
+  // Progress of a long operation of total steps, displayed as lines
+  //   <name>: <percent>% (<done>/<total>), <rate> <unit>(s)/s, ETA <seconds> s
+  // at most once per second. Steps can be reported concurrently; with a
+  // total of 0, the fraction is set directly (CGAL callbacks).
+  class Progress
+  {
+    typedef std::chrono::steady_clock Clock;
+
+    std::string m_name;
+    std::string m_unit;
+    std::size_t m_total;
+    std::atomic<std::size_t> m_done;
+    Clock::time_point m_start;
+    std::atomic<Clock::rep> m_next; // Time of the next line
+    std::mutex m_mutex;
+
+  public:
+
+    Progress (const std::string& name, std::size_t total = 0, const std::string& unit = "step")
+      : m_name (name), m_unit (unit), m_total (total), m_done (0)
+      , m_start (Clock::now())
+      , m_next ((m_start + std::chrono::seconds(1)).time_since_epoch().count())
+    { }
+
+    ~Progress()
+    {
+      if (progress_output() != -1 && !cancellation_requested())
+        print (1.);
+    }
+
+    void advance (std::size_t steps = 1)
+    {
+      std::size_t done = (m_done += steps);
+      if (progress_output() != -1 && m_total != 0)
+        update (double(done) / m_total);
+    }
+
+    void set (double fraction)
+    {
+      if (progress_output() != -1)
+        update (fraction);
+    }
+
+    // For CGAL callbacks: returns false to interrupt the algorithm
+    bool operator() (double fraction)
+    {
+      set (fraction);
+      return !cancellation_requested();
+    }
+
+  private:
+
+    void update (double fraction)
+    {
+      Clock::rep now = Clock::now().time_since_epoch().count();
+      Clock::rep next = m_next.load (std::memory_order_relaxed);
+      if (now < next
+          || !m_next.compare_exchange_strong (next, now + Clock::rep(std::chrono::duration_cast<Clock::duration>
+                                                                     (std::chrono::seconds(1)).count())))
+        return;
+      print (fraction);
+    }
+
+    void print (double fraction)
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      double elapsed = std::chrono::duration<double>(Clock::now() - m_start).count();
+
+      char line[256];
+      int size;
+      if (m_total != 0)
+      {
+        std::size_t done = (fraction >= 1. ? m_total : m_done.load());
+        double rate = (elapsed > 0. ? done / elapsed : 0.);
+        double eta = (rate > 0. ? (m_total - done) / rate : 0.);
+        size = std::snprintf (line, sizeof(line), "%s: %.1f%% (%zu/%zu), %.3g %s(s)/s, ETA %.0f s\n",
+                              m_name.c_str(), 100. * fraction, done, m_total, rate, m_unit.c_str(), eta);
+      }
+      else
+      {
+        double eta = (fraction > 0. ? elapsed * (1. - fraction) / fraction : 0.);
+        size = std::snprintf (line, sizeof(line), "%s: %.1f%%, ETA %.0f s\n",
+                              m_name.c_str(), 100. * fraction, eta);
+      }
+
+      if (size > 0)
+      {
+        ssize_t written = ::write (progress_output(), line, (std::min)(std::size_t(size), sizeof(line) - 1));
+        (void)written;
+      }
+    }
+  };
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_PROGRESS_H
@@ -0,0 +1,29 @@
+#ifndef CGALAPPS_RANDOM_H
+#define CGALAPPS_RANDOM_H
+
+#include <cstdint>
+
+namespace CGALApps
+{
+
+  // Counter-based pseudo-random numbers (SplitMix64 finalizer): the
+  // number drawn for a counter only depends on the seed and on the
+  // counter, so that parallel loops give the same results whatever
+  // the number of threads and the scheduling
+  inline std::uint64_t counter_random (std::uint64_t seed, std::uint64_t counter)
+  {
+    std::uint64_t z = seed + (counter + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  // Same as counter_random() mapped to [0;1)
+  inline double counter_random_uniform (std::uint64_t seed, std::uint64_t counter)
+  {
+    return double(counter_random (seed, counter) >> 11) * (1. / 9007199254740992.);
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_RANDOM_H
@@ -0,0 +1,59 @@
+#ifndef CGALAPPS_RANDOM_SIMPLIFY_POINT_SET_H
+#define CGALAPPS_RANDOM_SIMPLIFY_POINT_SET_H
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+#include "parallel.h"
+#include "random.h"
+
+namespace CGALApps
+{
+
+  // Same contract as CGAL::random_simplify_point_set() (removes exactly
+  // removed_percentage% of the points, moved at the end of the point set
+  // whose first removed element is returned), but the removed points
+  // are the ones with the lowest counter_random() values of their
+  // position: the result only depends on seed.
+  inline typename Point_set::iterator random_simplify_point_set (Point_set& points, double removed_percentage,
+                                                          std::uint64_t seed)
+  {
+    const std::size_t size = points.size();
+    const std::size_t nb_removed = std::size_t(double(size) * removed_percentage / 100.);
+
+    std::vector<std::pair<std::uint64_t, std::size_t> > keys (size);
+    CGALApps::parallel_for
+      (0, size,
+       [&](std::size_t i)
+       {
+         keys[i] = std::make_pair (counter_random (seed, i), i);
+       });
+
+    if (nb_removed < size)
+      std::nth_element (keys.begin(), keys.begin() + nb_removed, keys.end());
+
+    typename Point_set::Property_map<unsigned char> removed
+      = points.add_property_map<unsigned char> ("random_simplify_removed", 0).first;
+    CGALApps::parallel_for
+      (0, (std::min)(nb_removed, size),
+       [&](std::size_t j)
+       {
+         removed[*(points.begin() + keys[j].second)] = 1;
+       });
+
+    typename Point_set::iterator out
+      = std::stable_partition (points.begin(), points.end(),
+                               [&](const typename Point_set::Index& idx) -> bool
+                               {
+                                 return removed[idx] == 0;
+                               });
+    points.remove_property_map (removed);
+    return out;
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_RANDOM_SIMPLIFY_POINT_SET_H
@@ -0,0 +1,71 @@
+#ifndef CGALAPPS_REMOVE_OUTLIERS_H
+#define CGALAPPS_REMOVE_OUTLIERS_H
+
+#include <algorithm>
+#include <vector>
+
+#include "types.h"
+#include "neighbor_search.h"
+#include "parallel.h"
+
+namespace CGALApps
+{
+
+  // Same selection as CGAL::remove_outliers(): points are sorted by
+  // the average squared distance to their nearest neighbors, and the
+  // points with the highest averages (at most threshold_percent of
+  // them) above threshold_distance^2 are outliers. Outliers are moved
+  // to the end of the point set (other points keep their order) and
+  // the first outlier is returned.
+  inline typename Point_set::iterator remove_outliers (Point_set& points, const Neighbor_graph& graph,
+                                                double threshold_percent, double threshold_distance)
+  {
+    First_touch_vector<Point_3> local;
+    CGALApps::local_copy (points, points.point_map(), local);
+
+    std::vector<double> score (points.size());
+    CGALApps::parallel_for
+      (0, points.size(),
+       [&](std::size_t i)
+       {
+         const Point_3& query = local[i];
+         double sum = 0.;
+         for (const std::size_t* n = graph.neighbors_begin(i); n != graph.neighbors_end(i); ++ n)
+           sum += CGAL::squared_distance (query, local[*n]);
+         score[i] = sum / (graph.neighbors_end(i) - graph.neighbors_begin(i));
+       });
+
+    std::vector<std::size_t> sorted (points.size());
+    for (std::size_t i = 0; i < sorted.size(); ++ i)
+      sorted[i] = i;
+    CGALApps::parallel_sort (sorted.begin(), sorted.end(),
+                             [&](std::size_t a, std::size_t b) -> bool
+                             {
+                               return score[a] < score[b] || (score[a] == score[b] && a < b);
+                             });
+
+    std::size_t first_to_remove = std::size_t (double(sorted.size()) * ((100. - threshold_percent) / 100.));
+    while (first_to_remove != sorted.size()
+           && score[sorted[first_to_remove]] < threshold_distance * threshold_distance)
+      ++ first_to_remove;
+
+    std::vector<char> outlier (points.size(), 0);
+    for (std::size_t i = first_to_remove; i < sorted.size(); ++ i)
+      outlier[sorted[i]] = 1;
+
+    std::vector<typename Point_set::Index> indices (points.begin(), points.end());
+    typename Point_set::iterator it = points.begin();
+    for (std::size_t i = 0; i < indices.size(); ++ i)
+      if (!outlier[i])
+        *(it ++) = indices[i];
+    typename Point_set::iterator out = it;
+    for (std::size_t i = 0; i < indices.size(); ++ i)
+      if (outlier[i])
+        *(it ++) = indices[i];
+
+    return out;
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_REMOVE_OUTLIERS_H
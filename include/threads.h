@@ -0,0 +1,201 @@
+#ifndef CGALAPPS_THREADS_H
+#define CGALAPPS_THREADS_H
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef CGAL_LINKED_WITH_TBB
+#include <tbb/global_control.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_scheduler_observer.h>
+#endif
+
+namespace CGALApps
+{
+
+  // CPUs the process may run on (restricted by taskset, cgroups...),
+  // with the NUMA node of each of them (0 if unknown)
+  inline std::vector<std::pair<int, int> > available_cpus()
+  {
+    std::vector<std::pair<int, int> > out; // (node, cpu)
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    if (sched_getaffinity (0, sizeof(cpu_set_t), &set) != 0)
+      return out;
+
+    std::vector<int> node_of (CPU_SETSIZE, 0);
+    for (int node = 0; ; ++ node)
+    {
+      std::ifstream f (("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist").c_str());
+      if (!f)
+        break;
+
+      // Format: "0-15,64-79"
+      std::string list;
+      std::getline (f, list);
+      std::istringstream iss (list);
+      std::string range;
+      while (std::getline (iss, range, ','))
+      {
+        std::size_t dash = range.find ('-');
+        int first = std::stoi (range.substr (0, dash));
+        int last = (dash == std::string::npos ? first : std::stoi (range.substr (dash + 1)));
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++ cpu)
+          node_of[cpu] = node;
+      }
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++ cpu)
+      if (CPU_ISSET (cpu, &set))
+        out.push_back (std::make_pair (node_of[cpu], cpu));
+#endif
+    return out;
+  }
+
+  // Order in which threads are pinned to CPUs:
+  //  - compact: fill the CPUs of a NUMA node before using the next one
+  //  - scatter: round robin over NUMA nodes, so that all sockets (and
+  //    their memory bandwidth) are used even with few threads
+  inline std::vector<int> affinity_order (const std::string& policy)
+  {
+    std::vector<std::pair<int, int> > cpus = available_cpus();
+    std::sort (cpus.begin(), cpus.end());
+
+    std::vector<int> out;
+    if (policy == "compact")
+    {
+      for (const std::pair<int, int>& c : cpus)
+        out.push_back (c.second);
+    }
+    else if (policy == "scatter")
+    {
+      std::vector<std::vector<int> > nodes;
+      for (std::size_t i = 0; i < cpus.size(); ++ i)
+      {
+        if (i == 0 || cpus[i].first != cpus[i-1].first)
+          nodes.push_back (std::vector<int>());
+        nodes.back().push_back (cpus[i].second);
+      }
+      for (std::size_t i = 0; out.size() < cpus.size(); ++ i)
+        for (const std::vector<int>& node : nodes)
+          if (i < node.size())
+            out.push_back (node[i]);
+    }
+    return out;
+  }
+
+  inline bool pin_current_thread (int cpu)
+  {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    CPU_SET (cpu, &set);
+    return (pthread_setaffinity_np (pthread_self(), sizeof(cpu_set_t), &set) == 0);
+#else
+    return false;
+#endif
+  }
+
+#ifdef CGAL_LINKED_WITH_TBB
+
+  // Pins each thread entering an arena to the CPU of its slot
+  class Affinity_observer : public tbb::task_scheduler_observer
+  {
+    std::vector<int> m_cpus;
+
+  public:
+
+    Affinity_observer (const std::vector<int>& cpus)
+      : m_cpus (cpus)
+    {
+      observe (true);
+    }
+
+    ~Affinity_observer()
+    {
+      observe (false);
+    }
+
+    void on_scheduler_entry (bool)
+    {
+      int slot = tbb::this_task_arena::current_thread_index();
+      if (slot >= 0)
+        pin_current_thread (m_cpus[std::size_t(slot) % m_cpus.size()]);
+    }
+  };
+
+#endif
+
+  // Maximum number of threads and affinity policy of all parallel
+  // algorithms (CGAL's Parallel_tag functions included, as they run in
+  // the same TBB arenas), for the lifetime of the object
+  class Thread_control
+  {
+#ifdef CGAL_LINKED_WITH_TBB
+    std::unique_ptr<tbb::global_control> m_control;
+    std::unique_ptr<Affinity_observer> m_observer;
+#endif
+
+  public:
+
+    // 0 threads keeps the default (all available cores)
+    Thread_control (unsigned int nb_threads, const std::string& affinity)
+    {
+#ifdef CGAL_LINKED_WITH_TBB
+      if (nb_threads != 0)
+        m_control.reset (new tbb::global_control (tbb::global_control::max_allowed_parallelism, nb_threads));
+
+      std::vector<int> cpus = affinity_order (affinity);
+      if (!cpus.empty())
+      {
+        // The main thread works in the arenas too
+        pin_current_thread (cpus[0]);
+        m_observer.reset (new Affinity_observer (cpus));
+      }
+#else
+      (void)nb_threads;
+      (void)affinity;
+#endif
+    }
+  };
+
+  // Allocator that default-initializes instead of value-initializing:
+  // resizing a vector does not write its memory, so pages are first
+  // touched (and placed on the NUMA node of the thread) by the parallel
+  // loop that fills the vector
+  template <typename T>
+  class First_touch_allocator : public std::allocator<T>
+  {
+  public:
+
+    template <typename U>
+    struct rebind { typedef First_touch_allocator<U> other; };
+
+    First_touch_allocator() { }
+    template <typename U>
+    First_touch_allocator (const First_touch_allocator<U>&) { }
+
+    template <typename U>
+    void construct (U* p) { ::new (static_cast<void*>(p)) U; }
+
+    template <typename U, typename... Args>
+    void construct (U* p, Args&&... args) { ::new (static_cast<void*>(p)) U (std::forward<Args>(args)...); }
+  };
+
+  template <typename T>
+  using First_touch_vector = std::vector<T, First_touch_allocator<T> >;
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_THREADS_H
@@ -0,0 +1,109 @@
+#ifndef CGALAPPS_TILING_H
+#define CGALAPPS_TILING_H
+
+#include <array>
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include "types.h"
+
+namespace CGALApps
+{
+
+  // Cubic spatial tile: `points` first lists the `nb_core` points lying
+  // in the tile, followed by the points of neighbor tiles lying within
+  // the margin (only used as context)
+  struct Tile
+  {
+    double min[3];
+    double max[3];
+    std::vector<typename Point_set::Index> points;
+    std::size_t nb_core;
+
+    bool contains (const Point_3& p) const
+    {
+      for (int j = 0; j < 3; ++ j)
+        if (p[j] < min[j] || p[j] >= max[j])
+          return false;
+      return true;
+    }
+  };
+
+  inline void compute_tiles (const Point_set& points, double tile_size, double margin, std::vector<Tile>& tiles)
+  {
+    typedef std::array<long, 3> Tile_key;
+
+    double min[3] = { std::numeric_limits<double>::max(),
+                      std::numeric_limits<double>::max(),
+                      std::numeric_limits<double>::max() };
+    for (typename Point_set::const_iterator it = points.begin(); it != points.end(); ++ it)
+      for (int j = 0; j < 3; ++ j)
+        min[j] = (std::min)(min[j], points.point(*it)[j]);
+
+    std::map<Tile_key, std::size_t> map;
+    std::vector<Tile_key> point_keys;
+    point_keys.reserve (points.size());
+
+    // Core points
+    tiles.clear();
+    for (typename Point_set::const_iterator it = points.begin(); it != points.end(); ++ it)
+    {
+      const Point_3& p = points.point(*it);
+      Tile_key key;
+      for (int j = 0; j < 3; ++ j)
+        key[j] = long(std::floor ((p[j] - min[j]) / tile_size));
+      point_keys.push_back (key);
+
+      typename std::map<Tile_key, std::size_t>::iterator found
+        = map.insert (std::make_pair (key, tiles.size())).first;
+      if (found->second == tiles.size())
+      {
+        tiles.push_back (Tile());
+        for (int j = 0; j < 3; ++ j)
+        {
+          tiles.back().min[j] = min[j] + key[j] * tile_size;
+          tiles.back().max[j] = min[j] + (key[j] + 1) * tile_size;
+        }
+      }
+      tiles[found->second].points.push_back (*it);
+    }
+
+    for (std::size_t i = 0; i < tiles.size(); ++ i)
+      tiles[i].nb_core = tiles[i].points.size();
+
+    if (margin <= 0.)
+      return;
+
+    // Context points of neighbor tiles
+    std::size_t idx = 0;
+    for (typename Point_set::const_iterator it = points.begin(); it != points.end(); ++ it, ++ idx)
+    {
+      const Point_3& p = points.point(*it);
+      const Tile_key& key = point_keys[idx];
+
+      for (long x = -1; x <= 1; ++ x)
+        for (long y = -1; y <= 1; ++ y)
+          for (long z = -1; z <= 1; ++ z)
+          {
+            if (x == 0 && y == 0 && z == 0)
+              continue;
+
+            Tile_key neighbor = {{ key[0] + x, key[1] + y, key[2] + z }};
+            typename std::map<Tile_key, std::size_t>::iterator found = map.find (neighbor);
+            if (found == map.end())
+              continue;
+
+            Tile& tile = tiles[found->second];
+            bool inside = true;
+            for (int j = 0; j < 3 && inside; ++ j)
+              inside = (p[j] >= tile.min[j] - margin && p[j] < tile.max[j] + margin);
+            if (inside)
+              tile.points.push_back (*it);
+          }
+    }
+  }
+
+} // namespace CGALApps
+
+#endif // CGALAPPS_TILING_H
@@ -0,0 +1,86 @@
+#!/bin/sh
+#
+# Compares the running time of CGALApps programs on a given input.
+#
+# Usage: benchmark.sh <input> [neighbors] [tile-size]
+#
+# Apps are taken from PATH (or from $CGALAPPS_BIN if set). Tiled Poisson
+# reconstruction is measured if a tile size is given (the input then
+# needs normals).
+
+if [ $# -lt 1 ]; then
+  echo "Usage: $0 <input> [neighbors] [tile-size]" >&2
+  exit 1
+fi
+
+INPUT=$1
+K=${2:-12}
+TILE=$3
+BIN=${CGALAPPS_BIN:+$CGALAPPS_BIN/}
+
+# Runs an app in verbose mode and prints its timing line
+run ()
+{
+  NAME=$1
+  shift
+  TIME=$("${BIN}$NAME" "$@" -v -o /dev/null 2>&1 >/dev/null | sed -n 's/^Done in \(.*\) second(s)\./\1/p')
+  printf "%-40s %s s\n" "$NAME $*" "$TIME"
+}
+
+echo "[Normal estimation, k = $K]"
+run cgal_jet_estimate_normals "$INPUT" -n "$K"
+run cgal_pca_estimate_normals "$INPUT" -n "$K"
+
+# Runs an app in verbose mode and prints its neighbor query throughput
+run_search ()
+{
+  NAME=$1
+  shift
+  RATE=$("${BIN}$NAME" "$@" -v -o /dev/null 2>&1 >/dev/null | sed -n 's/.*, \(.*\) queries\/s per thread$/\1/p')
+  printf "%-40s %s queries/s per thread\n" "$NAME $*" "$RATE"
+}
+
+echo "[Neighbor search, k = $K]"
+for SEARCH in cgal scalar simd; do
+  run cgal_pca_estimate_normals "$INPUT" -n "$K" -S $SEARCH
+  run_search cgal_pca_estimate_normals "$INPUT" -n "$K" -S $SEARCH
+done
+
+echo "[Jet fitting, k = $K]"
+for ENGINE in cgal fixed; do
+  run cgal_jet_estimate_normals "$INPUT" -n "$K" -E $ENGINE
+  run cgal_jet_smooth_point_set "$INPUT" -n "$K" -E $ENGINE
+done
+
+# Runs an app with 1, 2, 4... threads up to the number of cores and
+# prints the speedup over one thread
+run_scaling ()
+{
+  NAME=$1
+  shift
+  CORES=$(nproc)
+  THREADS=1
+  REFERENCE=
+  while [ "$THREADS" -le "$CORES" ]; do
+    TIME=$("${BIN}$NAME" "$@" --threads $THREADS -v -o /dev/null 2>&1 >/dev/null | sed -n 's/^Done in \(.*\) second(s)\./\1/p')
+    REFERENCE=${REFERENCE:-$TIME}
+    SPEEDUP=$(awk "BEGIN { if ($TIME > 0) printf \"%.2f\", $REFERENCE / $TIME }")
+    printf "%-40s %3s thread(s) %s s (x%s)\n" "$NAME $*" "$THREADS" "$TIME" "$SPEEDUP"
+    if [ "$THREADS" -lt "$CORES" ] && [ $((THREADS * 2)) -gt "$CORES" ]; then
+      THREADS=$CORES
+    else
+      THREADS=$((THREADS * 2))
+    fi
+  done
+}
+
+echo "[Thread scaling, k = $K]"
+for AFFINITY in none compact scatter; do
+  run_scaling cgal_jet_estimate_normals "$INPUT" -n "$K" --affinity $AFFINITY
+  run_scaling cgal_pca_estimate_normals "$INPUT" -n "$K" --affinity $AFFINITY
+done
+
+if [ -n "$TILE" ]; then
+  echo "[Thread scaling, Poisson reconstruction on tiles of size $TILE]"
+  run_scaling cgal_poisson_surface_reconstruction "$INPUT" -t "$TILE"
+fi
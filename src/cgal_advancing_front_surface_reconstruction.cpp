@@ -1,42 +1,107 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
 
 #include <CGAL/Advancing_front_surface_reconstruction.h>
+#include <CGAL/Delaunay_triangulation_3.h>
+#include <CGAL/Triangulation_vertex_base_with_info_3.h>
 #include <CGAL/Real_timer.h>
 
-struct Length {
+#include <chrono>
 
-  double bound;
+namespace
+{
+
+  // Counters of the priority evaluations, shared by all copies of the
+  // priority functor
+  struct Length_statistics {
+
+    std::size_t evaluations;
+    std::size_t timed;
+    double time;
+
+    Length_statistics()
+      : evaluations(0), timed(0), time(0)
+    {}
+
+    // Time spent in all evaluations, extrapolated from the timed ones
+    double estimated_time() const
+    {
+      return (timed == 0 ? 0. : time * evaluations / timed);
+    }
+  };
+
+  // Facets with an edge longer than bound get an infinite priority.
+  // Squared edge lengths are compared to bound^2 (no square root).
+  struct Length {
 
-  Length(double bound)
-    : bound(bound)
-  {}
+    // One evaluation in timer_period is timed: reading the clock costs
+    // about as much as an evaluation
+    static const std::size_t timer_period = 64;
 
-  template <typename AdvancingFront, typename Cell_handle>
-  double operator() (const AdvancingFront& adv, Cell_handle& c,
+    double bound;
+    double squared_bound;
+    Length_statistics* statistics;
+
+    Length(double bound, Length_statistics* statistics = nullptr)
+      : bound(bound), squared_bound(bound * bound), statistics(statistics)
+    {}
+
+    template <typename AdvancingFront, typename Cell_handle>
+    double evaluate (const AdvancingFront& adv, Cell_handle& c,
                      const int& index) const
-  {
-    if(bound == 0){
+    {
+      if(bound == 0){
+        return adv.smallest_radius_delaunay_sphere (c, index);
+      }
+
+      const Point_3& pa = c->vertex((index+1)%4)->point();
+      const Point_3& pb = c->vertex((index+2)%4)->point();
+      const Point_3& pc = c->vertex((index+3)%4)->point();
+      if(CGAL::squared_distance(pa, pb) > squared_bound
+         || CGAL::squared_distance(pb, pc) > squared_bound
+         || CGAL::squared_distance(pa, pc) > squared_bound)
+        return adv.infinity();
+
       return adv.smallest_radius_delaunay_sphere (c, index);
     }
 
-    double d  = 0;
-    d = sqrt(squared_distance(c->vertex((index+1)%4)->point(),
-                              c->vertex((index+2)%4)->point()));
-    if(d>bound) return adv.infinity();
-    d = sqrt(squared_distance(c->vertex((index+2)%4)->point(),
-                              c->vertex((index+3)%4)->point()));
-    if(d>bound) return adv.infinity();
-    d = sqrt(squared_distance(c->vertex((index+1)%4)->point(),
-                              c->vertex((index+3)%4)->point()));
-    if(d>bound) return adv.infinity();
-
-    return adv.smallest_radius_delaunay_sphere (c, index);
-  }
-};
-
-int main (int argc, char** argv)
+    template <typename AdvancingFront, typename Cell_handle>
+    double operator() (const AdvancingFront& adv, Cell_handle& c,
+                       const int& index) const
+    {
+      if (statistics == nullptr || statistics->evaluations ++ % timer_period != 0)
+        return evaluate (adv, c, index);
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      double out = evaluate (adv, c, index);
+      ++ statistics->timed;
+      statistics->time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      return out;
+    }
+  };
+
+} // namespace
+
+// Vertices store the index of their input point. When TBB is
+// available, the triangulation is built with CGAL's parallel
+// (lock-based) insertion before being handed to the advancing front.
+typedef CGAL::Triangulation_vertex_base_with_info_3<std::size_t, Kernel> Vb_info;
+typedef CGAL::Advancing_front_surface_reconstruction_vertex_base_3<Kernel, Vb_info> Vb;
+typedef CGAL::Advancing_front_surface_reconstruction_cell_base_3<Kernel> Cb;
+#ifdef CGAL_LINKED_WITH_TBB
+typedef CGAL::Triangulation_data_structure_3<Vb, Cb, CGAL::Parallel_tag> Tds;
+#else
+typedef CGAL::Triangulation_data_structure_3<Vb, Cb> Tds;
+#endif
+typedef CGAL::Delaunay_triangulation_3<Kernel, Tds> Delaunay;
+typedef CGAL::Advancing_front_surface_reconstruction<Delaunay, Length> Reconstruction;
+typedef Reconstruction::Triangulation_data_structure_2 TDS_2;
+
+CGALAPPS_APP (cgal_advancing_front_surface_reconstruction) (int argc, char** argv)
 {
   bool verbose;
   std::string ifilename;
@@ -53,11 +118,8 @@ int main (int argc, char** argv)
 
   if(!args.parse(argc, argv))
   {
-    std::cout << "-------------------------------------------------" << std::endl
-              << "[CGALApps] Advancing Front Surface Reconstruction" << std::endl
-              << "-------------------------------------------------" << std::endl << std::endl
-              << "Reconstructs an interpolating surface based on a 3D Delaunay triangulation."
-              << std::endl << args.help();
+    CGALApps::print_help ("Advancing Front Surface Reconstruction",
+                          "Reconstructs an interpolating surface based on a 3D Delaunay triangulation.", args);
     return EXIT_SUCCESS;
   }
 
@@ -72,35 +134,82 @@ int main (int argc, char** argv)
     t.start();
   }
   
-  Point_set points;
-
-  CGALApps::read_point_set (ifilename, points);
-    
-  if (points.empty())
-  {
-    std::cerr << "Error: zero points read." << std::endl;
-    return EXIT_FAILURE;
-  }
-
-  Length priority(length);
-  
-  std::vector<Facet> facets;
-  CGAL::advancing_front_surface_reconstruction(points.points().begin(),
-                                               points.points().end(),
-                                               std::back_inserter(facets),
-                                               priority, radius, beta);
-
-  if (verbose)
-    std::cerr << facets.size() << " facet(s) created." << std::endl;
-  
-  CGALApps::write_surface (ifilename, points, facets);
-
-  if (verbose)
-  {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
-  }
-  
-  return EXIT_SUCCESS;
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".off",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       CGAL::Real_timer dt_time;
+       dt_time.start();
+
+       // Triangulation input is spatially sorted by the range insertion
+       std::vector<std::pair<Point_3, std::size_t> > input;
+       input.reserve (points.size());
+       CGAL::Bbox_3 bbox = points.point(*(points.begin())).bbox();
+       for (std::size_t i = 0; i < points.size(); ++ i)
+       {
+         const Point_3& p = points.point(*(points.begin() + i));
+         input.push_back (std::make_pair (p, i));
+         bbox = bbox + p.bbox();
+       }
+
+     #ifdef CGAL_LINKED_WITH_TBB
+       Delaunay::Lock_data_structure locking_ds (bbox, 50);
+       Delaunay dt (input.begin(), input.end(), &locking_ds);
+     #else
+       Delaunay dt (input.begin(), input.end());
+     #endif
+       std::vector<std::pair<Point_3, std::size_t> >().swap (input);
+
+       dt_time.stop();
+       if (verbose)
+         std::cerr << "Delaunay triangulation computed in " << dt_time.time() << " second(s)." << std::endl;
+
+       // Priority evaluations are only counted and timed in verbose mode
+       Length_statistics statistics;
+       Length priority(length, (verbose ? &statistics : nullptr));
+
+       CGAL::Real_timer afsr_time;
+       afsr_time.start();
+       Reconstruction reconstruction (dt, priority);
+       reconstruction.run (radius, beta);
+       afsr_time.stop();
+
+       if (verbose)
+         std::cerr << "Advancing front computed in " << afsr_time.time() << " second(s)." << std::endl
+                   << " * " << statistics.evaluations << " priority evaluation(s)" << std::endl
+                   << " * about " << statistics.estimated_time() << " second(s) spent in priority evaluation ("
+                   << 100. * statistics.estimated_time() / afsr_time.time() << "%, sampled)" << std::endl;
+
+       std::vector<Facet> facets;
+       const TDS_2& tds = reconstruction.triangulation_data_structure_2();
+       for (TDS_2::Face_iterator it = tds.faces_begin(); it != tds.faces_end(); ++ it)
+         if (it->is_on_surface())
+         {
+           Facet f = {{ it->vertex(0)->vertex_3()->info(),
+                        it->vertex(1)->vertex_3()->info(),
+                        it->vertex(2)->vertex_3()->info() }};
+           facets.push_back (f);
+         }
+
+       if (verbose)
+         std::cerr << facets.size() << " facet(s) created." << std::endl;
+
+       CGALApps::write_surface (ofilename, points, facets);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
 }
 
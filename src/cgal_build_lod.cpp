@@ -0,0 +1,139 @@
+#include "Args.h"
+#include "app.h"
+#include "types.h"
+#include "io.h"
+#include "batch.h"
+
+#include "build_lod.h"
+
+#include <boost/filesystem.hpp>
+
+#include <CGAL/Real_timer.h>
+
+CGALAPPS_APP (cgal_build_lod) (int argc, char** argv)
+{
+  bool verbose;
+  std::string ifilename;
+  std::string ofilename;
+  std::string odirname;
+  unsigned int depth;
+  unsigned int resolution;
+
+  CGALApps::Args args (verbose, ifilename);
+  args.add_option ("output,o", "Output file in PLY format (single file ordered coarse-to-fine)",
+                   ofilename, "", "stdout");
+  args.add_option ("output-dir,d", "Output directory (one PLY file per node)", odirname, "", "none");
+  args.add_option ("depth,D", "Maximum depth of the octree", depth, 8);
+  args.add_option ("resolution,r", "Per-axis resolution of the node subsample grid (log2)", resolution, 5);
+
+  if(!args.parse(argc, argv))
+  {
+    CGALApps::print_help ("Build LOD",
+                          "Builds an octree level-of-detail hierarchy where each node holds a representative\n"
+                          "subsample of its cell.", args);
+    std::cout << std::endl
+              << "Output modes:" << std::endl
+              << "  single file: all points ordered coarse-to-fine with a `lod` property, plus" << std::endl
+              << "               a page table `<output>.lod` (node, depth, first point, size)" << std::endl
+              << "  directory:   one file `<node>.ply` per node plus a `hierarchy.txt` index," << std::endl
+              << "               node `r` being the root and `r<octant>...` its descendants" << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (depth + resolution > 21)
+  {
+    std::cerr << "Error: depth + resolution should not exceed 21." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (args.cache_dir() != "")
+  {
+    std::cerr << "Error: results of this app cannot be cached (several outputs)." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (odirname != "" && args.batch() != "")
+  {
+    std::cerr << "Error: batch processing does not support directory output." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  CGAL::Real_timer t;
+  if (verbose)
+  {
+    std::cerr << "[CGALApps] Build LOD" << std::endl
+              << " * depth = " << depth << std::endl
+              << " * resolution = " << resolution << std::endl;
+    t.start();
+  }
+
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::read_point_set (ifilename, points);
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       std::vector<CGALApps::LOD_node> nodes;
+       CGALApps::build_lod (points, depth, resolution, nodes);
+
+       if (verbose)
+       {
+         std::vector<std::size_t> nb_points (depth + 1, 0);
+         std::vector<std::size_t> nb_nodes (depth + 1, 0);
+         for (const CGALApps::LOD_node& node : nodes)
+         {
+           nb_points[node.depth] += node.end - node.begin;
+           ++ nb_nodes[node.depth];
+         }
+         std::cerr << nodes.size() << " node(s) created." << std::endl;
+         for (unsigned int d = 0; d <= depth; ++ d)
+           std::cerr << " * depth " << d << ": " << nb_nodes[d] << " node(s), "
+                     << nb_points[d] << " point(s)" << std::endl;
+       }
+
+       if (odirname != "")
+       {
+         boost::filesystem::create_directories (odirname);
+
+         CGALApps::parallel_for
+           (0, nodes.size(),
+            [&](std::size_t n)
+            {
+              Point_set node_points;
+              node_points.copy_properties (points);
+              for (std::size_t i = nodes[n].begin; i < nodes[n].end; ++ i)
+                node_points.insert (points, *(points.begin() + i));
+              CGALApps::write_point_set (odirname + "/" + nodes[n].name + ".ply", node_points);
+            });
+
+         std::ofstream hierarchy ((odirname + "/hierarchy.txt").c_str());
+         for (const CGALApps::LOD_node& node : nodes)
+           hierarchy << node.name << " " << node.depth << " " << node.end - node.begin << std::endl;
+       }
+       else
+       {
+         Point_set::Property_map<int> lod = points.add_property_map<int>("lod", 0).first;
+         for (const CGALApps::LOD_node& node : nodes)
+           for (std::size_t i = node.begin; i < node.end; ++ i)
+             lod[*(points.begin() + i)] = int(node.depth);
+
+         CGALApps::write_point_set (ofilename, points);
+
+         if (ofilename != "")
+         {
+           std::ofstream table ((ofilename + ".lod").c_str());
+           for (const CGALApps::LOD_node& node : nodes)
+             table << node.name << " " << node.depth << " " << node.begin << " " << node.end - node.begin << std::endl;
+         }
+       }
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
+}
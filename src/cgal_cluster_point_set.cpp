@@ -1,13 +1,18 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
 
 #include "cluster_point_set.h"
-
+#include "parallel.h"
 
 #include <CGAL/Real_timer.h>
 
-int main (int argc, char** argv)
+#include <boost/filesystem.hpp>
+
+CGALAPPS_APP (cgal_cluster_point_set) (int argc, char** argv)
 {
   bool verbose;
   std::string ifilename;
@@ -15,24 +20,36 @@ int main (int argc, char** argv)
   double cluster;
   std::size_t min_points;
   std::string format;
+  std::string algorithm;
+  std::size_t min_neighbors;
+  bool stats;
+  std::string odirname;
   
   CGALApps::Args args (verbose, ifilename);
   args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
   args.add_option ("cluster,c", "Maximum distances between connected points", cluster, 0.1);
   args.add_option ("min-points,m", "Minimum number of point in shape", min_points, 0, "1% of all");
   args.add_option ("mode,m", "Output mode: [filter/biggest/label]", format, "filter");
+  args.add_option ("algorithm,a", "Clustering algorithm: [euclidean/dbscan]", algorithm, "euclidean");
+  args.add_option ("min-neighbors,n", "Minimum number of points at cluster distance of a core point (dbscan)",
+                   min_neighbors, 10);
+  args.add_option ("stats,s", "Write count, bounding box, centroid, covariance and oriented box "
+                   "of clusters to <output>.clusters.csv (or clusters.csv in split directory)", stats, false);
+  args.add_option ("split-dir,d", "Output directory with one PLY file per cluster (instead of output file)",
+                   odirname, "", "none");
   
   if(!args.parse(argc, argv))
   {
-    std::cout << "----------------------------------" << std::endl
-              << "[CGALApps] Cluster Point Set" << std::endl
-              << "----------------------------------" << std::endl << std::endl
-              << "Clusters a point set given a tolerance and a minimum number of points."
-              << std::endl << args.help() << std::endl
+    CGALApps::print_help ("Cluster Point Set",
+                          "Clusters a point set given a tolerance and a minimum number of points.", args);
+    std::cout << std::endl
               << "Output modes:" << std::endl
               << "  filter:  Keep all clusters with enough points (default mode)" << std::endl
               << "  biggest: Only keep biggest component" << std::endl
-              << "  label:   Keep all points and save one label per cluster" << std::endl;
+              << "  label:   Keep all points and save one label per cluster" << std::endl
+              << "Algorithms:" << std::endl
+              << "  euclidean: Connect all points closer than the cluster distance (default)" << std::endl
+              << "  dbscan:    Connect core points only, other points being noise (label -1)" << std::endl;
     return EXIT_SUCCESS;
   }
 
@@ -49,54 +66,128 @@ int main (int argc, char** argv)
     return EXIT_FAILURE;
   }
 
-  CGAL::Real_timer t;
-  if (verbose)
+  bool dbscan = false;
+  if (algorithm == "dbscan")
+    dbscan = true;
+  else if (algorithm != "euclidean")
   {
-    std::cerr << "[CGALApps] Cluster Point Set" << std::endl;
-    t.start();
+    std::cerr << "Error: unknown algorithm \"" << algorithm << "\"" << std::endl;
+    return EXIT_FAILURE;
   }
-  Point_set points;
 
-  CGALApps::read_point_set (ifilename, points);
-    
-  if (points.empty())
+  if (stats && ofilename == "" && odirname == "" && args.batch() == "")
   {
-    std::cerr << "Error: zero points read." << std::endl;
+    std::cerr << "Error: an output file is needed to write cluster statistics." << std::endl;
     return EXIT_FAILURE;
   }
 
-  if (min_points == 0)
-    min_points = std::size_t(points.size() * 0.01);
-  
-  if (verbose)
+  if (odirname != "" && args.batch() != "")
   {
-    std::cerr << " * cluster = " << cluster << std::endl
-              << " * min-points = " << min_points << std::endl
-              << " * output = ";
-    if (method == 1)
-      std::cerr << "biggest" << std::endl;
-    else if (method == 2)
-      std::cerr << "label" << std::endl;
-    else
-      std::cerr << "filter" << std::endl;
-
+    std::cerr << "Error: batch processing does not support directory output." << std::endl;
+    return EXIT_FAILURE;
   }
-  
-  CGALApps::cluster_point_set (points, cluster, min_points, method);
-
-  if (verbose && (method == 0 || method == 1))
-    std::cerr << 100. * points.garbage_size() / (points.size() + points.garbage_size())
-              << "% / " << points.garbage_size() << " point(s) removed ("
-              << points.size() << " point(s) remaining)." << std::endl;
 
-  CGALApps::write_point_set (ofilename, points);
+  if ((stats || odirname != "") && args.cache_dir() != "")
+  {
+    std::cerr << "Error: cluster statistics and directory output cannot be cached." << std::endl;
+    return EXIT_FAILURE;
+  }
 
+  CGAL::Real_timer t;
   if (verbose)
   {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
+    std::cerr << "[CGALApps] Cluster Point Set" << std::endl;
+    t.start();
   }
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       std::size_t file_min_points = (min_points == 0 ? std::size_t(points.size() * 0.01) : min_points);
+
+       if (verbose)
+       {
+         std::cerr << " * cluster = " << cluster << std::endl
+                   << " * min-points = " << file_min_points << std::endl
+                   << " * algorithm = " << algorithm << std::endl;
+         if (dbscan)
+           std::cerr << " * min-neighbors = " << min_neighbors << std::endl;
+         std::cerr << " * output = ";
+         if (method == 1)
+           std::cerr << "biggest" << std::endl;
+         else if (method == 2)
+           std::cerr << "label" << std::endl;
+         else
+           std::cerr << "filter" << std::endl;
+
+       }
+
+       std::vector<CGALApps::Point_cluster> clusters;
+       std::vector<CGALApps::Cluster_statistics> statistics;
+       if (dbscan)
+         CGALApps::dbscan_cluster_point_set (points, cluster, min_neighbors, file_min_points, clusters, statistics);
+       else
+         CGALApps::cluster_point_set (points, cluster, file_min_points, clusters, statistics);
+
+       if (verbose)
+       {
+         std::cerr << clusters.size() << " cluster(s) found." << std::endl;
+         CGALApps::print_arena_statistics (std::cerr, points.size());
+       }
+
+       if (odirname != "")
+         boost::filesystem::create_directories (odirname);
+
+       if (stats)
+       {
+         std::string sfilename = (odirname != "" ? odirname + "/clusters.csv" : ofilename + ".clusters.csv");
+         CGALApps::compute_oriented_boxes (points, clusters, statistics);
+         if (!CGALApps::write_cluster_statistics (sfilename, statistics))
+         {
+           std::cerr << "Error: cannot write " << sfilename << "." << std::endl;
+           return EXIT_FAILURE;
+         }
+       }
+
+       if (odirname != "")
+       {
+         CGALApps::parallel_for
+           (0, clusters.size(),
+            [&](std::size_t c)
+            {
+              Point_set cluster_points;
+              cluster_points.copy_properties (points);
+              for (const Point_set::Index& idx : clusters[c])
+                cluster_points.insert (points, idx);
+              CGALApps::write_point_set (odirname + "/cluster_" + std::to_string(c) + ".ply", cluster_points);
+            });
+       }
+       else
+       {
+         CGALApps::output_clusters (points, clusters, method);
+
+         if (verbose && (method == 0 || method == 1))
+           std::cerr << 100. * points.garbage_size() / (points.size() + points.garbage_size())
+                     << "% / " << points.garbage_size() << " point(s) removed ("
+                     << points.size() << " point(s) remaining)." << std::endl;
+
+         CGALApps::write_point_set (ofilename, points);
+
+         cache.store (ofilename);
+       }
+
+       CGALApps::print_done (verbose, t);
 
-  return EXIT_SUCCESS;
+       return EXIT_SUCCESS;
+     });
 }
 
@@ -1,60 +1,102 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
+
+#include "average_spacing.h"
 
 #include <CGAL/compute_average_spacing.h>
 #include <CGAL/Real_timer.h>
 
-int main (int argc, char** argv)
+CGALAPPS_APP (cgal_compute_average_spacing) (int argc, char** argv)
 {
   bool verbose;
   unsigned int nb_neighbors;
-  std::string filename;
+  std::string ifilename;
+  std::string ofilename;
+  std::string search;
+  bool adaptive;
   
-  CGALApps::Args args (verbose, filename);
+  CGALApps::Args args (verbose, ifilename);
+  args.add_option ("output,o", "Output file", ofilename, "", "stdout");
   args.add_option ("neighbors,n", "Number of nearest neighbors used", nb_neighbors, 6);
+  args.add_option ("adaptive,A", "Use per-point neighborhood sizes (scale_k property, see cgal_estimate_scale)"
+                   " bounded by --neighbors", adaptive, false);
+  args.add_option ("search,S", "Neighbor search: [cgal/simd/scalar]", search, "cgal");
   
   if(!args.parse(argc, argv))
   {
-    std::cout << "----------------------------------" << std::endl
-              << "[CGALApps] Compute Average Spacing" << std::endl
-              << "----------------------------------" << std::endl << std::endl
-              << "Reads a point set and estimates the average spacing based on a set of nearest"
-              << std::endl << "neighbors."
-              << std::endl << args.help();
+    CGALApps::print_help ("Compute Average Spacing",
+                          "Reads a point set and estimates the average spacing based on a set of nearest\n"
+                          "neighbors.", args);
+    std::cout << std::endl
+              << "Neighbor searches:" << std::endl
+              << "  cgal:   CGAL k-d tree (default)" << std::endl
+              << "  simd:   Bucket k-d tree with the widest SIMD kernel of the CPU (AVX-512/AVX2)" << std::endl
+              << "  scalar: Bucket k-d tree with the scalar kernel" << std::endl;
     return EXIT_SUCCESS;
   }
-  
-  
-  CGAL::Real_timer t;
-  if (verbose)
-  {
-    std::cerr << "[CGALApps] Compute Average Spacing" << std::endl
-              << " * neighbors = " << nb_neighbors << std::endl;
-    t.start();
-  }
-  
-  Point_set points;
 
-  CGALApps::read_point_set (filename, points);
-    
-  if (points.empty())
+  CGALApps::Search_method search_method;
+  if (!CGALApps::search_method_from_string (search, search_method))
   {
-    std::cerr << "Error: zero points read." << std::endl;
+    std::cerr << "Error: unknown neighbor search \"" << search << "\"" << std::endl;
     return EXIT_FAILURE;
   }
-  
-  FT average_spacing = CGAL::compute_average_spacing<Concurrency_tag>
-    (points, nb_neighbors);
-  
-  std::cout << average_spacing << std::endl;
-  
+
+  CGAL::Real_timer t;
   if (verbose)
   {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
+    std::cerr << "[CGALApps] Compute Average Spacing" << std::endl
+              << " * neighbors = " << nb_neighbors << std::endl
+              << " * adaptive = " << (adaptive ? "yes" : "no") << std::endl
+              << " * search = " << search << std::endl;
+    t.start();
   }
   
-  return EXIT_SUCCESS;
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".txt",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       std::vector<unsigned int> sizes;
+       if (adaptive && !CGALApps::adaptive_neighborhood_sizes (points, 2, nb_neighbors, sizes))
+       {
+         std::cerr << "Error: point set does not have a scale_k property." << std::endl;
+         return EXIT_FAILURE;
+       }
+
+       FT average_spacing;
+       // CGAL's version only takes a global number of neighbors
+       if (search_method == CGALApps::KD_TREE && !adaptive)
+         average_spacing = CGAL::compute_average_spacing<Concurrency_tag>
+           (points, nb_neighbors);
+       else
+       {
+         CGALApps::Neighbor_graph graph = (adaptive ? CGALApps::Neighbor_graph (points, sizes, search_method)
+                                           : CGALApps::Neighbor_graph (points, nb_neighbors, search_method));
+         if (verbose)
+           graph.print_statistics (std::cerr);
+         average_spacing = CGALApps::average_spacing (points, graph);
+       }
+
+       CGALApps::write_value (ofilename, average_spacing);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
 }
 
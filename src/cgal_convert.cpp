@@ -1,84 +1,117 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
+#include "point_stream.h"
 
 #include <CGAL/Real_timer.h>
 
-int main (int argc, char** argv)
+CGALAPPS_APP (cgal_convert) (int argc, char** argv)
 {
   bool verbose;
   std::string ifilename;
   std::string ofilename;
   bool ascii;
+  bool stream;
   
   CGALApps::Args args (verbose, ifilename);
   args.add_option ("output,o", "Output file", ofilename, "out.ply");
   args.add_option ("ascii,a", "Force ASCII format for PLY", ascii, false);
+  args.add_option ("stream", "Overlap reading, converting and writing (XYZ input, XYZ or PLY output)", stream, false);
 
   if(!args.parse(argc, argv))
   {
-    std::cout << "----------------------------------" << std::endl
-              << "[CGALApps] Convert" << std::endl
-              << "----------------------------------" << std::endl << std::endl
-              << "Converts a point set to another format (deduced from the user-given extension)."
-              << std::endl << args.help();
+    CGALApps::print_help ("Convert",
+                          "Converts a point set to another format (deduced from the user-given extension).", args);
     return EXIT_SUCCESS;
   }
 
+  // Streamed reading stops on cancellation
+  if (stream && args.cache_dir() == "")
+    CGALApps::install_cancellation_handler();
+
   CGAL::Real_timer t;
   if (verbose)
     std::cerr << "[CGALApps] Convert" << std::endl;
       
-  Point_set points;
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       CGALApps::Result_cache cache (args, verbose);
 
-  CGALApps::read_point_set (ifilename, points);
+       CGALApps::Point_stream_format format = (ascii ? CGALApps::PLY_ASCII_STREAM : CGALApps::PLY_BINARY_STREAM);
+       if (CGALApps::extension_of_file_is(ofilename, "xyz"))
+         format = CGALApps::XYZ_STREAM;
+       if (stream && !cache.enabled()
+           && (format == CGALApps::XYZ_STREAM || CGALApps::extension_of_file_is(ofilename, "ply"))
+           && CGALApps::can_stream_xyz_points (ifilename, ofilename, format))
+       {
+         if (verbose)
+           std::cerr << " * Streamed convertion" << std::endl;
 
-  if (points.empty())
-  {
-    std::cerr << "Error: zero points read." << std::endl;
-    return EXIT_FAILURE;
-  }
+         CGALApps::Stream_statistics statistics
+           = CGALApps::stream_xyz_points (ifilename, ofilename, format, [](std::size_t) { return true; });
+         if (statistics.nb_read == 0)
+         {
+           std::cerr << "Error: zero points read." << std::endl;
+           return EXIT_FAILURE;
+         }
 
-  std::ofstream output(ofilename);
-  
-  if(CGALApps::extension_of_file_is(ofilename, "ply"))
-  {
-    if (!ascii)
-    {
-      if (verbose)
-        std::cerr << " * Convertion to binary PLY" << std::endl;
-      CGAL::set_binary_mode(output);
-    }
-    else if (verbose)
-      std::cerr << " * Convertion to ASCII PLY" << std::endl;
-    
-    write_ply_point_set (output, points);
-  }
-  else if(CGALApps::extension_of_file_is(ofilename, "off"))
-  {
-    if (verbose)
-      std::cerr << " * Convertion to OFF" << std::endl;
-    write_off_point_set (output, points);
-  }
-  else if(CGALApps::extension_of_file_is(ofilename, "xyz"))
-  {
-    if (verbose)
-      std::cerr << " * Convertion to XYZ" << std::endl;
-    write_xyz_point_set (output, points);
-  }
-  else
-  {
-    if (verbose)
-      std::cerr << "Error: unknown output format." << std::endl;
-    return EXIT_FAILURE;
-  }
-  
-  if (verbose)
-  {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
-  }
-  
-  return EXIT_SUCCESS;
+         CGALApps::print_done (verbose, t);
+
+         return EXIT_SUCCESS;
+       }
+
+       Point_set points;
+
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       std::ofstream output(ofilename);
+
+       if(CGALApps::extension_of_file_is(ofilename, "ply"))
+       {
+         if (!ascii)
+         {
+           if (verbose)
+             std::cerr << " * Convertion to binary PLY" << std::endl;
+           CGAL::set_binary_mode(output);
+         }
+         else if (verbose)
+           std::cerr << " * Convertion to ASCII PLY" << std::endl;
+
+         write_ply_point_set (output, points);
+       }
+       else if(CGALApps::extension_of_file_is(ofilename, "off"))
+       {
+         if (verbose)
+           std::cerr << " * Convertion to OFF" << std::endl;
+         write_off_point_set (output, points);
+       }
+       else if(CGALApps::extension_of_file_is(ofilename, "xyz"))
+       {
+         if (verbose)
+           std::cerr << " * Convertion to XYZ" << std::endl;
+         write_xyz_point_set (output, points);
+       }
+       else
+       {
+         if (verbose)
+           std::cerr << "Error: unknown output format." << std::endl;
+         return EXIT_FAILURE;
+       }
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
 }
 
@@ -0,0 +1,101 @@
+#include "Args.h"
+#include "app.h"
+#include "types.h"
+#include "io.h"
+#include "batch.h"
+#include "cache.h"
+
+#include <CGAL/edge_aware_upsample_point_set.h>
+#include <CGAL/property_map.h>
+#include <CGAL/Real_timer.h>
+
+typedef std::pair<Point_3, Vector_3> Point_with_normal;
+
+CGALAPPS_APP (cgal_edge_aware_upsample_point_set) (int argc, char** argv)
+{
+  bool verbose;
+  std::string ifilename;
+  std::string ofilename;
+  std::size_t number;
+  double sharpness;
+  double sensitivity;
+  double radius;
+  
+  CGALApps::Args args (verbose, ifilename);
+  args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
+  args.add_option ("number,N", "Number of output points", number, 0, "4 times the input size");
+  args.add_option ("sharpness,s", "Sharpness angle in degrees", sharpness, 25.);
+  args.add_option ("sensitivity,e", "Edge sensitivity in [0;1]", sensitivity, 0.);
+  args.add_option ("radius,r", "Initial neighbor radius", radius, -1., "3 times the average spacing");
+  
+  if(!args.parse(argc, argv))
+  {
+    CGALApps::print_help ("Edge Aware Upsample Point Set",
+                          "Upsamples a point set while preserving sharp features.", args);
+    return EXIT_SUCCESS;
+  }
+
+  CGAL::Real_timer t;
+  if (verbose)
+  {
+    std::cerr << "[CGALApps] Edge Aware Upsample Point Set" << std::endl
+              << " * number = " << number << std::endl
+              << " * sharpness = " << sharpness << std::endl
+              << " * sensitivity = " << sensitivity << std::endl
+              << " * radius = " << radius << std::endl;
+    t.start();
+  }
+
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       if (!(points.has_normal_map()))
+       {
+         std::cerr << "Error: point set does not have normal vectors." << std::endl;
+         return EXIT_FAILURE;
+       }
+
+       std::size_t file_number = (number == 0 ? 4 * points.size() : number);
+
+       // New points are written with their normal vectors, which requires
+       // (point, normal) pairs as both input and output
+       std::vector<Point_with_normal> input;
+       input.reserve (points.size());
+       for (typename Point_set::iterator it = points.begin(); it != points.end(); ++ it)
+         input.push_back (std::make_pair (points.point(*it), points.normal(*it)));
+
+       std::vector<Point_with_normal> output;
+       CGAL::edge_aware_upsample_point_set<Concurrency_tag>
+         (input, std::back_inserter (output),
+          CGAL::parameters::point_map (CGAL::First_of_pair_property_map<Point_with_normal>())
+          .normal_map (CGAL::Second_of_pair_property_map<Point_with_normal>())
+          .sharpness_angle (sharpness)
+          .edge_sensitivity (sensitivity)
+          .neighbor_radius (radius)
+          .number_of_output_points (file_number));
+
+       if (verbose)
+         std::cerr << output.size() << " point(s) created." << std::endl;
+
+       for (const Point_with_normal& pwn : output)
+         points.insert (pwn.first, pwn.second);
+
+       CGALApps::write_point_set (ofilename, points);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
+}
@@ -1,8 +1,14 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
+#include "progress.h"
+#include "random.h"
 
 #include <CGAL/Shape_detection_3.h>
+#include <CGAL/Random.h>
 #include <CGAL/Real_timer.h>
 
 typedef CGAL::Shape_detection_3::Shape_detection_traits
@@ -15,13 +21,14 @@ typedef CGAL::Shape_detection_3::Torus<Traits>                   Torus_shape;
 typedef CGAL::Shape_detection_3::Sphere<Traits>                  Sphere_shape;
 
 
-int main (int argc, char** argv)
+CGALAPPS_APP (cgal_efficient_ransac) (int argc, char** argv)
 {
   bool verbose;
   std::string ifilename;
   std::string ofilename;
   Efficient_ransac::Parameters parameters;
   bool planes, cylinders, cones, torus, spheres;
+  unsigned int seed;
   
   CGALApps::Args args (verbose, ifilename);
   args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
@@ -33,6 +40,7 @@ int main (int argc, char** argv)
   args.add_option ("normal,n", "Maximum normal deviation in radiants", parameters.normal_threshold, 0.45);
   args.add_option ("cluster,c", "Maximum distances between connected points", parameters.cluster_epsilon,
                    -1, "1% of bounding box diagonal");
+  args.add_option ("seed,s", "Seed of the random sampling and colors (same seed, same output)", seed, 0);
 
   args.add_section ("Shapes");
   args.add_option ("planes,P", "Detect planes", planes, false);
@@ -43,14 +51,16 @@ int main (int argc, char** argv)
 
   if(!args.parse(argc, argv))
   {
-    std::cout << "---------------------------" << std::endl
-              << "[CGALApps] Efficient RANSAC" << std::endl
-              << "---------------------------" << std::endl << std::endl
-              << "Efficient RANSAC algorithm to detect shapes in a point set."
-              << std::endl << args.help();
+    CGALApps::print_help ("Efficient RANSAC",
+                          "Efficient RANSAC algorithm to detect shapes in a point set.", args);
     return EXIT_SUCCESS;
   }
 
+#if CGAL_VERSION_NR >= 1041400000
+  // Shape detection is interrupted by its callback
+  CGALApps::install_cancellation_handler();
+#endif
+
   CGAL::Real_timer t;
   if (verbose)
   {
@@ -60,6 +70,7 @@ int main (int argc, char** argv)
               << " * epsilon = " << parameters.epsilon << std::endl
               << " * cluster = " << parameters.cluster_epsilon << std::endl
               << " * normal = " << parameters.normal_threshold << std::endl
+              << " * seed = " << seed << std::endl
               << " * shapes =";
     if (planes)
       std::cerr << " planes";
@@ -76,99 +87,110 @@ int main (int argc, char** argv)
   }
 
   
-  Point_set points;
-
-  CGALApps::read_point_set (ifilename, points);
-    
-  if (points.empty())
-  {
-    std::cerr << "Error: zero points read." << std::endl;
-    return EXIT_FAILURE;
-  }
-
-  if (!(points.has_normal_map()))
-  {
-    std::cerr << "Error: point set does not have normal vectors." << std::endl;
-    return EXIT_FAILURE;
-  }
-
-  Efficient_ransac ransac;
-  ransac.set_input(points,
-                   points.point_map(),
-                   points.normal_map());
-
-  bool at_least_one_shape = false;
-  if (planes)
-  {
-    ransac.add_shape_factory<Plane_shape>();
-    at_least_one_shape = true;
-  }
-  if (cylinders)
-  {
-    ransac.add_shape_factory<Cylinder_shape>();
-    at_least_one_shape = true;
-  }
-  if (cones)
-  {
-    ransac.add_shape_factory<Cone_shape>();
-    at_least_one_shape = true;
-  }
-  if (torus)
-  {
-    ransac.add_shape_factory<Torus_shape>();
-    at_least_one_shape = true;
-  }
-  if (spheres)
-  {
-    ransac.add_shape_factory<Sphere_shape>();
-    at_least_one_shape = true;
-  }
-
-  if (!at_least_one_shape)
-  {
-    std::cerr << "Error: at least one shape type should be used (see --planes, --cylinders, etc)." << std::endl;
-    return EXIT_FAILURE;
-  }
-
-  ransac.detect(parameters);
-
-  if (verbose)
-    std::cerr << ransac.shapes().size() << " shape(s) detected." << std::endl;
-
-  Point_set::Property_map<int> label_map = points.add_property_map<int>("shape_index", -1).first;
-  Point_set::Property_map<unsigned char> red_map = points.add_property_map<unsigned char>("red", 0).first;
-  Point_set::Property_map<unsigned char> green_map = points.add_property_map<unsigned char>("green", 0).first;
-  Point_set::Property_map<unsigned char> blue_map = points.add_property_map<unsigned char>("blue", 0).first;
-
-  CGAL::Random rand(time(0));
-  int idx = 0;
-  BOOST_FOREACH(boost::shared_ptr<Efficient_ransac::Shape> shape, ransac.shapes())
-  {
-    unsigned char r, g, b;
-
-    r = static_cast<unsigned char>(64 + rand.get_int(0, 192));
-    g = static_cast<unsigned char>(64 + rand.get_int(0, 192));
-    b = static_cast<unsigned char>(64 + rand.get_int(0, 192));
-
-    BOOST_FOREACH(std::size_t i, shape->indices_of_assigned_points())
-    {
-      Point_set::Index pos = *(points.begin() + i);
-      label_map[pos] = idx;
-      red_map[pos] = r;
-      green_map[pos] = g;
-      blue_map[pos] = b;
-    }
-    ++ idx;
-  }
-    
-  CGALApps::write_point_set (ofilename, points);
-
-  if (verbose)
-  {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
-  }
-
-  return EXIT_SUCCESS;
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       if (!(points.has_normal_map()))
+       {
+         std::cerr << "Error: point set does not have normal vectors." << std::endl;
+         return EXIT_FAILURE;
+       }
+
+       Efficient_ransac ransac;
+       ransac.set_input(points,
+                        points.point_map(),
+                        points.normal_map());
+
+       bool at_least_one_shape = false;
+       if (planes)
+       {
+         ransac.add_shape_factory<Plane_shape>();
+         at_least_one_shape = true;
+       }
+       if (cylinders)
+       {
+         ransac.add_shape_factory<Cylinder_shape>();
+         at_least_one_shape = true;
+       }
+       if (cones)
+       {
+         ransac.add_shape_factory<Cone_shape>();
+         at_least_one_shape = true;
+       }
+       if (torus)
+       {
+         ransac.add_shape_factory<Torus_shape>();
+         at_least_one_shape = true;
+       }
+       if (spheres)
+       {
+         ransac.add_shape_factory<Sphere_shape>();
+         at_least_one_shape = true;
+       }
+
+       if (!at_least_one_shape)
+       {
+         std::cerr << "Error: at least one shape type should be used (see --planes, --cylinders, etc)." << std::endl;
+         return EXIT_FAILURE;
+       }
+
+       // Efficient_RANSAC draws its samples from CGAL's default random
+       // generator (one per thread)
+       CGAL::get_default_random() = CGAL::Random (seed);
+#if CGAL_VERSION_NR >= 1041400000
+       // Interrupted on cancellation, keeping the shapes detected so far
+       CGALApps::Progress progress ("Shape detection");
+       ransac.detect(parameters, [&](double fraction) -> bool { return progress (fraction); });
+#else
+       ransac.detect(parameters);
+#endif
+
+       if (verbose)
+         std::cerr << ransac.shapes().size() << " shape(s) detected." << std::endl;
+
+       Point_set::Property_map<int> label_map = points.add_property_map<int>("shape_index", -1).first;
+       Point_set::Property_map<unsigned char> red_map = points.add_property_map<unsigned char>("red", 0).first;
+       Point_set::Property_map<unsigned char> green_map = points.add_property_map<unsigned char>("green", 0).first;
+       Point_set::Property_map<unsigned char> blue_map = points.add_property_map<unsigned char>("blue", 0).first;
+
+       int idx = 0;
+       BOOST_FOREACH(boost::shared_ptr<Efficient_ransac::Shape> shape, ransac.shapes())
+       {
+         unsigned char r, g, b;
+
+         std::uint64_t color = CGALApps::counter_random (seed, std::uint64_t(idx));
+         r = static_cast<unsigned char>(64 + (color & 0xFFFF) % 192);
+         g = static_cast<unsigned char>(64 + ((color >> 16) & 0xFFFF) % 192);
+         b = static_cast<unsigned char>(64 + ((color >> 32) & 0xFFFF) % 192);
+
+         BOOST_FOREACH(std::size_t i, shape->indices_of_assigned_points())
+         {
+           Point_set::Index pos = *(points.begin() + i);
+           label_map[pos] = idx;
+           red_map[pos] = r;
+           green_map[pos] = g;
+           blue_map[pos] = b;
+         }
+         ++ idx;
+       }
+
+       CGALApps::write_point_set (ofilename, points);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
 }
 
@@ -0,0 +1,151 @@
+#include "Args.h"
+#include "app.h"
+#include "types.h"
+#include "io.h"
+#include "batch.h"
+#include "cache.h"
+
+#include "neighbor_search.h"
+
+#include <CGAL/estimate_scale.h>
+#include <CGAL/Real_timer.h>
+
+CGALAPPS_APP (cgal_estimate_scale) (int argc, char** argv)
+{
+  bool verbose;
+  std::string ifilename;
+  std::string ofilename;
+  std::string type;
+  bool local;
+  std::size_t samples;
+
+  CGALApps::Args args (verbose, ifilename);
+  args.add_option ("output,o", "Output file (PLY format in local mode, text otherwise)", ofilename, "", "stdout");
+  args.add_option ("type,t", "Type of scale [k/range]", type, "k");
+  args.add_option ("local,l", "Estimate one scale per point instead of a global one", local, false);
+  args.add_option ("samples,s", "Number of points where local scales are estimated", samples, 0, "all");
+
+  if(!args.parse(argc, argv))
+  {
+    CGALApps::print_help ("Estimate Scale",
+                          "Estimates the scale of a point set, either as a number of nearest neighbors or as\n"
+                          "a range, globally or for each point.", args);
+    std::cout << std::endl
+              << "Global mode prints the scale. Local mode writes the point set with a `scale_k`"
+              << std::endl << "(int) or `scale_range` (double) property. When using --samples, scales are"
+              << std::endl << "estimated on a subset of the points and each point takes the scale of the"
+              << std::endl << "closest sample. Apps with an --adaptive option use `scale_k` as a per-point"
+              << std::endl << "number of neighbors." << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (type != "k" && type != "range")
+  {
+    std::cerr << "Error: unknown type \"" << type << "\"" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  CGAL::Real_timer t;
+  if (verbose)
+  {
+    std::cerr << "[CGALApps] Estimate Scale" << std::endl
+              << " * type = " << type << std::endl
+              << " * local = " << (local ? "yes" : "no") << std::endl
+              << " * samples = " << samples << std::endl;
+    t.start();
+  }
+
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, (local ? ".ply" : ".txt"),
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       if (!local)
+       {
+         if (type == "k")
+           CGALApps::write_value (ofilename, CGAL::estimate_global_k_neighbor_scale
+                                  (points, CGAL::parameters::point_map (points.point_map())));
+         else
+           CGALApps::write_value (ofilename, CGAL::estimate_global_range_scale
+                                  (points, CGAL::parameters::point_map (points.point_map())));
+       }
+       else
+       {
+         // Query points (all points if no sampling)
+         bool sampling = (samples != 0 && samples < points.size());
+         Point_set queries;
+         if (sampling)
+         {
+           // Exactly `samples` queries, evenly spread over the point set
+           for (std::size_t j = 0; j < samples; ++ j)
+             queries.insert (points.point(*(points.begin() + j * points.size() / samples)));
+         }
+         const Point_set& query_points = (sampling ? queries : points);
+
+         std::vector<double> scales;
+         scales.reserve (query_points.size());
+         if (type == "k")
+           CGAL::estimate_local_k_neighbor_scales
+             (points, query_points.points(), std::back_inserter (scales),
+              CGAL::parameters::point_map (points.point_map()));
+         else
+           CGAL::estimate_local_range_scales
+             (points, query_points.points(), std::back_inserter (scales),
+              CGAL::parameters::point_map (points.point_map()));
+
+         // Each point takes the scale of the closest query
+         std::vector<double> point_scales (points.size());
+         if (!sampling)
+           point_scales.swap (scales);
+         else
+         {
+           CGALApps::Neighbor_query query (queries);
+           CGALApps::parallel_for
+             (0, points.size(),
+              [&](std::size_t i)
+              {
+                typename Point_set::Index closest;
+                query.k_neighbors (points.point(*(points.begin() + i)), 1, &closest);
+                point_scales[i] = scales[std::size_t(closest)];
+              });
+         }
+
+         if (type == "k")
+         {
+           Point_set::Property_map<int> scale_map = points.add_property_map<int>("scale_k", 0).first;
+           for (std::size_t i = 0; i < points.size(); ++ i)
+             scale_map[*(points.begin() + i)] = int(point_scales[i]);
+         }
+         else
+         {
+           Point_set::Property_map<double> scale_map = points.add_property_map<double>("scale_range", 0.).first;
+           for (std::size_t i = 0; i < points.size(); ++ i)
+             scale_map[*(points.begin() + i)] = point_scales[i];
+         }
+
+         if (verbose)
+         {
+           double min = *std::min_element (point_scales.begin(), point_scales.end());
+           double max = *std::max_element (point_scales.begin(), point_scales.end());
+           std::cerr << "Scales estimated on " << query_points.size() << " point(s), between "
+                     << min << " and " << max << "." << std::endl;
+         }
+
+         CGALApps::write_point_set (ofilename, points);
+       }
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
+}
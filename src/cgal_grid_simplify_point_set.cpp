@@ -1,11 +1,14 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
 
 #include <CGAL/grid_simplify_point_set.h>
 #include <CGAL/Real_timer.h>
 
-int main (int argc, char** argv)
+CGALAPPS_APP (cgal_grid_simplify_point_set) (int argc, char** argv)
 {
   bool verbose;
   double epsilon;
@@ -18,11 +21,8 @@ int main (int argc, char** argv)
 
   if(!args.parse(argc, argv))
   {
-    std::cout << "----------------------------------" << std::endl
-              << "[CGALApps] Grid Simplify Point Set" << std::endl
-              << "----------------------------------" << std::endl << std::endl
-              << "Simplifies a point set based on a regular 3D grid."
-              << std::endl << args.help();
+    CGALApps::print_help ("Grid Simplify Point Set",
+                          "Simplifies a point set based on a regular 3D grid.", args);
     return EXIT_SUCCESS;
   }
   
@@ -34,31 +34,33 @@ int main (int argc, char** argv)
     t.start();
   }
   
-  Point_set points;
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
 
-  CGALApps::read_point_set (ifilename, points);
-    
-  if (points.empty())
-  {
-    std::cerr << "Error: zero points read." << std::endl;
-    return EXIT_FAILURE;
-  }
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
 
-  points.remove (CGAL::grid_simplify_point_set (points, epsilon), points.end());
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
 
-  if (verbose)
-    std::cerr << 100. * points.garbage_size() / (points.size() + points.garbage_size())
-              << "% / " << points.garbage_size() << " point(s) removed ("
-              << points.size() << " point(s) remaining)." << std::endl;
+       points.remove (CGAL::grid_simplify_point_set (points, epsilon), points.end());
 
-  CGALApps::write_point_set (ofilename, points);
+       if (verbose)
+         std::cerr << 100. * points.garbage_size() / (points.size() + points.garbage_size())
+                   << "% / " << points.garbage_size() << " point(s) removed ("
+                   << points.size() << " point(s) remaining)." << std::endl;
 
-  if (verbose)
-  {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
-  }
+       CGALApps::write_point_set (ofilename, points);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
 
-  return EXIT_SUCCESS;
+       return EXIT_SUCCESS;
+     });
 }
 
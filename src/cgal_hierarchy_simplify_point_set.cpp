@@ -0,0 +1,116 @@
+#include "Args.h"
+#include "app.h"
+#include "types.h"
+#include "io.h"
+#include "batch.h"
+#include "cache.h"
+
+#include "parallel.h"
+#include "tiling.h"
+
+#include <CGAL/hierarchy_simplify_point_set.h>
+#include <CGAL/Real_timer.h>
+
+CGALAPPS_APP (cgal_hierarchy_simplify_point_set) (int argc, char** argv)
+{
+  bool verbose;
+  std::string ifilename;
+  std::string ofilename;
+  unsigned int size;
+  double variation;
+  double tile_size;
+
+  CGALApps::Args args (verbose, ifilename);
+  args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
+  args.add_option ("size,s", "Maximum cluster size", size, 10);
+  args.add_option ("variation,m", "Maximum surface variation", variation, 1. / 3.);
+  args.add_option ("tile-size,t", "Process independent cubic tiles of this size", tile_size, 0., "no tiling");
+
+  if(!args.parse(argc, argv))
+  {
+    CGALApps::print_help ("Hierarchy Simplify Point Set",
+                          "Simplifies a point set by recursively clustering it until clusters are small and\n"
+                          "flat enough (preserves sharp features).", args);
+    return EXIT_SUCCESS;
+  }
+
+  CGAL::Real_timer t;
+  if (verbose)
+  {
+    std::cerr << "[CGALApps] Hierarchy Simplify Point Set" << std::endl
+              << " * size = " << size << std::endl
+              << " * variation = " << variation << std::endl
+              << " * tile-size = " << tile_size << std::endl;
+    t.start();
+  }
+
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       if (tile_size > 0.)
+       {
+         // Tiles are simplified independently (and in parallel), which
+         // bounds the memory used by the clustering to the tile size
+         std::vector<CGALApps::Tile> tiles;
+         CGALApps::compute_tiles (points, tile_size, 0., tiles);
+
+         if (verbose)
+           std::cerr << tiles.size() << " tile(s) used." << std::endl;
+
+         Point_set::Property_map<unsigned char> keep
+           = points.add_property_map<unsigned char>("keep", 0).first;
+
+         CGALApps::parallel_for
+           (0, tiles.size(),
+            [&](std::size_t i)
+            {
+              std::vector<typename Point_set::Index>& tile = tiles[i].points;
+              typename std::vector<typename Point_set::Index>::iterator last
+                = CGAL::hierarchy_simplify_point_set
+                (tile, CGAL::parameters::point_map (points.point_map())
+                 .size (size)
+                 .maximum_variation (variation));
+              for (typename std::vector<typename Point_set::Index>::iterator it = tile.begin(); it != last; ++ it)
+                keep[*it] = 1;
+              std::vector<typename Point_set::Index>().swap (tile);
+            });
+
+         points.remove (std::stable_partition (points.begin(), points.end(),
+                                               [&](const typename Point_set::Index& idx) -> bool
+                                               {
+                                                 return keep[idx] == 1;
+                                               }),
+                        points.end());
+         points.remove_property_map (keep);
+       }
+       else
+         points.remove (CGAL::hierarchy_simplify_point_set
+                        (points, CGAL::parameters::point_map (points.point_map())
+                         .size (size)
+                         .maximum_variation (variation)),
+                        points.end());
+
+       if (verbose)
+         std::cerr << 100. * points.garbage_size() / (points.size() + points.garbage_size())
+                   << "% / " << points.garbage_size() << " point(s) removed ("
+                   << points.size() << " point(s) remaining)." << std::endl;
+
+       CGALApps::write_point_set (ofilename, points);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
+}
@@ -0,0 +1,145 @@
+#include "Args.h"
+#include "app.h"
+#include "types.h"
+#include "io.h"
+#include "batch.h"
+
+#include "grid_index.h"
+#include "incremental_update.h"
+#include "jet_fitting.h"
+
+#include <CGAL/Real_timer.h>
+
+CGALAPPS_APP (cgal_incremental_update) (int argc, char** argv)
+{
+  bool verbose;
+  std::string ifilename;
+  std::string ofilename;
+  std::string ufilename;
+  std::string xfilename;
+  unsigned int nb_neighbors;
+  unsigned int fitting;
+  double cell_size;
+
+  CGALApps::Args args (verbose, ifilename, false);
+  args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
+  args.add_option ("update,u", "New points to insert", ufilename, "", "none");
+  args.add_option ("index,x", "Spatial index of the input", xfilename, "", "<input>.grid");
+  args.add_option ("neighbors,n", "Number of nearest neighbors used", nb_neighbors, 24);
+  args.add_option ("fitting,f", "Degree of fitting of the jets used for normals", fitting, 2);
+  args.add_option ("cell-size,c", "Cell size of the spatial index if the input has none", cell_size, 0., "automatic");
+
+  if(!args.parse(argc, argv))
+  {
+    CGALApps::print_help ("Incremental Update",
+                          "Inserts new points in a processed point set, only recomputing the neighborhoods\n"
+                          "affected by the insertions.\n\n"
+                          "Processed point sets have the normal vectors, and the `knn_radius` (distance to the\n"
+                          "k-th neighbor) and `outlier_score` (average squared distance to the neighbors)\n"
+                          "properties. An input without them is fully processed first, and later updates\n"
+                          "should use the same number of neighbors. The spatial index is read from\n"
+                          "`<input>.grid` (built if missing) and saved to `<output>.grid` (not saved if the\n"
+                          "output is stdout).", args);
+    return EXIT_SUCCESS;
+  }
+
+  if (!CGALApps::jet_fitting_supports (fitting))
+  {
+    std::cerr << "Error: degree of fitting should be between 1 and 4." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (nb_neighbors == 0)
+  {
+    std::cerr << "Error: number of neighbors should be positive." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if ((ufilename != "" || xfilename != "") && args.batch() != "")
+  {
+    std::cerr << "Error: batch processing does not support update or index files." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  CGAL::Real_timer t;
+  if (verbose)
+  {
+    std::cerr << "[CGALApps] Incremental Update" << std::endl
+              << " * update = " << (ufilename == "" ? "none" : ufilename) << std::endl
+              << " * neighbors = " << nb_neighbors << std::endl
+              << " * fitting = " << fitting << std::endl;
+    t.start();
+  }
+
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::read_point_set (ifilename, points);
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       bool processed = CGALApps::has_incremental_properties (points);
+       CGALApps::add_incremental_properties (points);
+
+       CGALApps::Grid_index index;
+       std::size_t nb_indexed = 0;
+       if (processed)
+       {
+         std::string index_filename = (xfilename != "" ? xfilename : ifilename + ".grid");
+         if (ifilename != "" && index.load (index_filename, points.size()))
+         {
+           if (verbose)
+             std::cerr << "Index " << index_filename << " loaded (" << index.nb_cells() << " cell(s))." << std::endl;
+         }
+         else
+         {
+           index.build (points, points.property_map<double>("knn_radius").first, cell_size);
+           if (verbose)
+             std::cerr << "Index built (" << index.nb_cells() << " cell(s))." << std::endl;
+         }
+         nb_indexed = points.size();
+       }
+       else if (verbose)
+         std::cerr << "Input is not processed, all points are processed." << std::endl;
+
+       if (ufilename != "")
+       {
+         Point_set update;
+         CGALApps::read_point_set (ufilename, update, false);
+         if (update.empty())
+         {
+           std::cerr << "Error: zero points read in " << ufilename << "." << std::endl;
+           return EXIT_FAILURE;
+         }
+         points.join (update);
+       }
+
+       CGALApps::Incremental_statistics statistics;
+       CGALApps::incremental_update (points, nb_indexed, index, nb_neighbors, fitting, cell_size, statistics);
+
+       if (verbose)
+         std::cerr << statistics.nb_inserted << " point(s) inserted, "
+                   << statistics.nb_affected << " neighborhood(s) updated out of " << nb_indexed << std::endl
+                   << statistics.nb_propagated << " normal(s) oriented from a neighbor, "
+                   << statistics.nb_seeds << " upwards" << std::endl;
+
+       CGALApps::write_point_set (ofilename, points);
+
+       if (ofilename == "")
+         std::cerr << "Warning: output is stdout, the spatial index is not saved"
+                   << " (the next update will rebuild it)." << std::endl;
+       else if (!index.save (ofilename + ".grid"))
+       {
+         std::cerr << "Error: cannot write " << ofilename << ".grid." << std::endl;
+         return EXIT_FAILURE;
+       }
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
+}
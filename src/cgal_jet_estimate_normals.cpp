@@ -1,11 +1,18 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
+
+#include "jet_fitting.h"
+#include "parallel.h"
+#include "progress.h"
 
 #include <CGAL/jet_estimate_normals.h>
 #include <CGAL/Real_timer.h>
 
-int main (int argc, char** argv)
+CGALAPPS_APP (cgal_jet_estimate_normals) (int argc, char** argv)
 {
   bool verbose;
   double epsilon;
@@ -13,55 +20,138 @@ int main (int argc, char** argv)
   std::string ofilename;
   unsigned int nb_neighbors;
   unsigned int fitting;
+  std::string engine;
+  bool adaptive;
+  std::string search;
 
   CGALApps::Args args (verbose, ifilename);
   args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
   args.add_option ("neighbors,n", "Number of nearest neighbors used", nb_neighbors, 12);
   args.add_option ("fitting,f", "Degree of fitting", fitting, 2);
+  args.add_option ("engine,E", "Jet fitting engine: [fixed/cgal]", engine, "fixed");
+  args.add_option ("adaptive,A", "Use per-point neighborhood sizes (scale_k property, see cgal_estimate_scale)"
+                   " bounded by --neighbors", adaptive, false);
+  args.add_option ("search,S", "Neighbor search of the fixed engine: [cgal/simd/scalar]", search, "cgal");
   
   if(!args.parse(argc, argv))
   {
-    std::cout << "-------------------------------" << std::endl
-              << "[CGALApps] Jet Estimate Normals" << std::endl
-              << "-------------------------------" << std::endl << std::endl
-              << "Estimates the normal vectors of a point set based on a parametric surface estimation."
-              << std::endl << args.help();
+    CGALApps::print_help ("Jet Estimate Normals",
+                          "Estimates the normal vectors of a point set based on a parametric surface estimation.", args);
+    std::cout << std::endl
+              << "Engines:" << std::endl
+              << "  fixed: Fixed-size fitting for degrees 1 to 4, CGAL otherwise (default)" << std::endl
+              << "  cgal:  CGAL's generic Monge_via_jet_fitting" << std::endl
+              << std::endl
+              << "Neighbor searches:" << std::endl
+              << "  cgal:   CGAL k-d tree (default)" << std::endl
+              << "  simd:   Bucket k-d tree with the widest SIMD kernel of the CPU (AVX-512/AVX2)" << std::endl
+              << "  scalar: Bucket k-d tree with the scalar kernel" << std::endl;
     return EXIT_SUCCESS;
   }
-  
-  CGAL::Real_timer t;
-  if (verbose)
+
+  if (engine != "fixed" && engine != "cgal")
   {
-    std::cerr << "[CGALApps] Jet Estimate Normals" << std::endl
-              << " * neighbors = " << nb_neighbors << std::endl
-              << " * fitting = " << fitting << std::endl;
-    t.start();
+    std::cerr << "Error: unknown engine \"" << engine << "\"" << std::endl;
+    return EXIT_FAILURE;
+  }
+  bool fixed = (engine == "fixed" && CGALApps::jet_fitting_supports (fitting));
+  if (adaptive && !fixed)
+  {
+    std::cerr << "Error: adaptive neighborhoods require the fixed engine (degrees 1 to 4)." << std::endl;
+    return EXIT_FAILURE;
   }
 
-  Point_set points;
-
-  CGALApps::read_point_set (ifilename, points);
-    
-  if (points.empty())
+  CGALApps::Search_method search_method;
+  if (!CGALApps::search_method_from_string (search, search_method))
   {
-    std::cerr << "Error: zero points read." << std::endl;
+    std::cerr << "Error: unknown neighbor search \"" << search << "\"" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (search_method != CGALApps::KD_TREE && !fixed)
+  {
+    std::cerr << "Error: bucket neighbor searches require the fixed engine (degrees 1 to 4)." << std::endl;
     return EXIT_FAILURE;
   }
 
-  points.add_normal_map();
-  CGAL::jet_estimate_normals<Concurrency_tag> (points, nb_neighbors,
-                                               CGAL::parameters::point_map(points.point_map()).
-                                               normal_map(points.normal_map()).
-                                               degree_fitting(fitting));
+  // The fixed engine and CGAL's callback (CGAL >= 4.14) check cancellation
+  if (fixed || CGAL_VERSION_NR >= 1041400000)
+    CGALApps::install_cancellation_handler();
 
-  CGALApps::write_point_set (ofilename, points);
-  
+  CGAL::Real_timer t;
   if (verbose)
   {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
+    std::cerr << "[CGALApps] Jet Estimate Normals" << std::endl
+              << " * neighbors = " << nb_neighbors << std::endl
+              << " * fitting = " << fitting << std::endl
+              << " * engine = " << (fixed ? "fixed" : "cgal") << std::endl
+              << " * adaptive = " << (adaptive ? "yes" : "no") << std::endl
+              << " * search = " << search << std::endl;
+    t.start();
   }
-  
-  return EXIT_SUCCESS;
+
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       // A jet of degree d needs (d+1)(d+2)/2 points
+       std::vector<unsigned int> sizes;
+       if (adaptive && !CGALApps::adaptive_neighborhood_sizes (points, (fitting + 1) * (fitting + 2) / 2,
+                                                               nb_neighbors, sizes))
+       {
+         std::cerr << "Error: point set does not have a scale_k property." << std::endl;
+         return EXIT_FAILURE;
+       }
+
+       CGAL::Real_timer fitting_timer;
+       fitting_timer.start();
+
+       points.add_normal_map();
+       if (fixed)
+       {
+         CGALApps::Neighbor_graph graph = (adaptive ? CGALApps::Neighbor_graph (points, sizes, search_method)
+                                           : CGALApps::Neighbor_graph (points, nb_neighbors, search_method));
+         if (verbose)
+           graph.print_statistics (std::cerr);
+         CGALApps::jet_estimate_normals (points, graph, fitting);
+       }
+       else
+       {
+#if CGAL_VERSION_NR >= 1041400000
+         CGALApps::Progress progress ("Jet fitting");
+         CGAL::jet_estimate_normals<Concurrency_tag> (points, nb_neighbors,
+                                                      CGAL::parameters::point_map(points.point_map()).
+                                                      normal_map(points.normal_map()).
+                                                      degree_fitting(fitting).
+                                                      callback([&](double fraction) -> bool { return progress (fraction); }));
+#else
+         CGAL::jet_estimate_normals<Concurrency_tag> (points, nb_neighbors,
+                                                      CGAL::parameters::point_map(points.point_map()).
+                                                      normal_map(points.normal_map()).
+                                                      degree_fitting(fitting));
+#endif
+       }
+
+       if (verbose && fitting_timer.time() > 0.)
+         std::cerr << points.size() << " jet(s) fitted in " << fitting_timer.time() << " second(s), "
+                   << points.size() / (fitting_timer.time() * CGALApps::nb_threads())
+                   << " jet(s)/s per thread" << std::endl;
+
+       CGALApps::write_point_set (ofilename, points);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
 }
 
@@ -1,11 +1,18 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
+
+#include "jet_fitting.h"
+#include "parallel.h"
+#include "progress.h"
 
 #include <CGAL/jet_smooth_point_set.h>
 #include <CGAL/Real_timer.h>
 
-int main (int argc, char** argv)
+CGALAPPS_APP (cgal_jet_smooth_point_set) (int argc, char** argv)
 {
   bool verbose;
   std::string ifilename;
@@ -14,6 +21,9 @@ int main (int argc, char** argv)
   unsigned int fitting;
   unsigned int monge;
   std::size_t repeat;
+  std::string engine;
+  bool adaptive;
+  std::string search;
   
   CGALApps::Args args (verbose, ifilename);
   args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
@@ -21,17 +31,54 @@ int main (int argc, char** argv)
   args.add_option ("fitting,f", "Degree of fitting", fitting, 2);
   args.add_option ("monge,m", "Monge degree", monge, 2);
   args.add_option ("repeat,r", "Number of iterations", repeat, 1);
+  args.add_option ("engine,E", "Jet fitting engine: [fixed/cgal]", engine, "fixed");
+  args.add_option ("adaptive,A", "Use per-point neighborhood sizes (scale_k property, see cgal_estimate_scale)"
+                   " bounded by --neighbors", adaptive, false);
+  args.add_option ("search,S", "Neighbor search of the fixed engine: [cgal/simd/scalar]", search, "cgal");
   
   if(!args.parse(argc, argv))
   {
-    std::cout << "-------------------------------" << std::endl
-              << "[CGALApps] Jet Smooth Point Set" << std::endl
-              << "-------------------------------" << std::endl << std::endl
-              << "Smooths a point set based on a parametric surface estimation."
-              << std::endl << args.help();
+    CGALApps::print_help ("Jet Smooth Point Set",
+                          "Smooths a point set based on a parametric surface estimation.", args);
+    std::cout << std::endl
+              << "Engines:" << std::endl
+              << "  fixed: Fixed-size fitting for degrees 1 to 4, CGAL otherwise (default)" << std::endl
+              << "  cgal:  CGAL's generic Monge_via_jet_fitting" << std::endl
+              << std::endl
+              << "Neighbor searches:" << std::endl
+              << "  cgal:   CGAL k-d tree (default)" << std::endl
+              << "  simd:   Bucket k-d tree with the widest SIMD kernel of the CPU (AVX-512/AVX2)" << std::endl
+              << "  scalar: Bucket k-d tree with the scalar kernel" << std::endl;
     return EXIT_SUCCESS;
   }
 
+  if (engine != "fixed" && engine != "cgal")
+  {
+    std::cerr << "Error: unknown engine \"" << engine << "\"" << std::endl;
+    return EXIT_FAILURE;
+  }
+  bool fixed = (engine == "fixed" && CGALApps::jet_fitting_supports (fitting));
+  if (adaptive && !fixed)
+  {
+    std::cerr << "Error: adaptive neighborhoods require the fixed engine (degrees 1 to 4)." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  CGALApps::Search_method search_method;
+  if (!CGALApps::search_method_from_string (search, search_method))
+  {
+    std::cerr << "Error: unknown neighbor search \"" << search << "\"" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (search_method != CGALApps::KD_TREE && !fixed)
+  {
+    std::cerr << "Error: bucket neighbor searches require the fixed engine (degrees 1 to 4)." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The fixed engine and CGAL's callback (CGAL >= 4.14) check cancellation
+  if (fixed || CGAL_VERSION_NR >= 1041400000)
+    CGALApps::install_cancellation_handler();
 
   CGAL::Real_timer t;
   if (verbose)
@@ -40,35 +87,81 @@ int main (int argc, char** argv)
               << " * nb_neighbors = " << nb_neighbors << std::endl
               << " * fitting = " << fitting << std::endl
               << " * monge = " << monge << std::endl
-              << " * repeat = " << repeat << std::endl;
+              << " * repeat = " << repeat << std::endl
+              << " * engine = " << (fixed ? "fixed" : "cgal") << std::endl
+              << " * adaptive = " << (adaptive ? "yes" : "no") << std::endl
+              << " * search = " << search << std::endl;
     t.start();
   }
 
-  Point_set points;
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
 
-  CGALApps::read_point_set (ifilename, points);
-    
-  if (points.empty())
-  {
-    std::cerr << "Error: zero points read." << std::endl;
-    return EXIT_FAILURE;
-  }
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
 
-  for (std::size_t i = 0; i < repeat; ++ i)
-    CGAL::jet_smooth_point_set<Concurrency_tag>
-      (points, nb_neighbors,
-       CGAL::parameters::point_map (points.point_map())
-       .degree_fitting (fitting)
-       .degree_monge (monge));
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
 
-  CGALApps::write_point_set (ofilename, points);
-  
-  if (verbose)
-  {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
-  }
+       // A jet of degree d needs (d+1)(d+2)/2 points. Sizes are read
+       // once: the scale of a point does not change when it is smoothed.
+       std::vector<unsigned int> sizes;
+       if (adaptive && !CGALApps::adaptive_neighborhood_sizes (points, (fitting + 1) * (fitting + 2) / 2,
+                                                               nb_neighbors, sizes))
+       {
+         std::cerr << "Error: point set does not have a scale_k property." << std::endl;
+         return EXIT_FAILURE;
+       }
+
+       CGAL::Real_timer fitting_timer;
+       fitting_timer.start();
+
+       // The Monge degree does not change the projection on the jet, it
+       // is only used by the CGAL engine
+       for (std::size_t i = 0; i < repeat; ++ i)
+         if (fixed)
+         {
+           CGALApps::Neighbor_graph graph = (adaptive ? CGALApps::Neighbor_graph (points, sizes, search_method)
+                                             : CGALApps::Neighbor_graph (points, nb_neighbors, search_method));
+           if (verbose)
+             graph.print_statistics (std::cerr);
+           CGALApps::jet_smooth_point_set (points, graph, fitting);
+         }
+         else
+         {
+#if CGAL_VERSION_NR >= 1041400000
+           CGALApps::Progress progress ("Jet fitting");
+           CGAL::jet_smooth_point_set<Concurrency_tag>
+             (points, nb_neighbors,
+              CGAL::parameters::point_map (points.point_map())
+              .degree_fitting (fitting)
+              .degree_monge (monge)
+              .callback ([&](double fraction) -> bool { return progress (fraction); }));
+#else
+           CGAL::jet_smooth_point_set<Concurrency_tag>
+             (points, nb_neighbors,
+              CGAL::parameters::point_map (points.point_map())
+              .degree_fitting (fitting)
+              .degree_monge (monge));
+#endif
+         }
+
+       if (verbose && fitting_timer.time() > 0.)
+         std::cerr << repeat * points.size() << " jet(s) fitted in " << fitting_timer.time() << " second(s), "
+                   << repeat * points.size() / (fitting_timer.time() * CGALApps::nb_threads())
+                   << " jet(s)/s per thread" << std::endl;
+
+       CGALApps::write_point_set (ofilename, points);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
 
-  return EXIT_SUCCESS;
+       return EXIT_SUCCESS;
+     });
 }
 
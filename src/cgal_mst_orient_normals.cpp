@@ -1,11 +1,14 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
 
 #include <CGAL/mst_orient_normals.h>
 #include <CGAL/Real_timer.h>
 
-int main (int argc, char** argv)
+CGALAPPS_APP (cgal_mst_orient_normals) (int argc, char** argv)
 {
   bool verbose;
   double epsilon;
@@ -19,11 +22,8 @@ int main (int argc, char** argv)
   
   if(!args.parse(argc, argv))
   {
-    std::cout << "------------------------------" << std::endl
-              << "[CGALApps] MST Orient Normals" << std::endl
-              << "------------------------------" << std::endl << std::endl
-              << "Orients the normal vectors of a point set based on a minimum spanning tree."
-              << std::endl << args.help();
+    CGALApps::print_help ("MST Orient Normals",
+                          "Orients the normal vectors of a point set based on a minimum spanning tree.", args);
     return EXIT_SUCCESS;
   }
 
@@ -35,38 +35,40 @@ int main (int argc, char** argv)
     t.start();
   }
 
-  Point_set points;
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
 
-  CGALApps::read_point_set (ifilename, points);
-    
-  if (points.empty())
-  {
-    std::cerr << "Error: zero points read." << std::endl;
-    return EXIT_FAILURE;
-  }
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
 
-  if (!(points.has_normal_map()))
-  {
-    std::cerr << "Error: point set does not have normal vectors." << std::endl;
-    return EXIT_FAILURE;
-  }
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
 
-  typename Point_set::iterator it = CGAL::mst_orient_normals (points, nb_neighbors);
-  if (verbose)
-  {
-    std::ptrdiff_t nb_unoriented = std::distance (it, points.end());
-    if (nb_unoriented != 0)
-      std::cerr << nb_unoriented << " point(s) were not properly oriented." << std::endl;
-  }
+       if (!(points.has_normal_map()))
+       {
+         std::cerr << "Error: point set does not have normal vectors." << std::endl;
+         return EXIT_FAILURE;
+       }
 
-  CGALApps::write_point_set (ofilename, points);
+       typename Point_set::iterator it = CGAL::mst_orient_normals (points, nb_neighbors);
+       if (verbose)
+       {
+         std::ptrdiff_t nb_unoriented = std::distance (it, points.end());
+         if (nb_unoriented != 0)
+           std::cerr << nb_unoriented << " point(s) were not properly oriented." << std::endl;
+       }
 
-  if (verbose)
-  {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
-  }
-  
-  return EXIT_SUCCESS;
+       CGALApps::write_point_set (ofilename, points);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
 }
 
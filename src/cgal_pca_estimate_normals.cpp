@@ -0,0 +1,92 @@
+#include "Args.h"
+#include "app.h"
+#include "types.h"
+#include "io.h"
+#include "batch.h"
+#include "cache.h"
+
+#include "pca_estimate_normals.h"
+
+#include <CGAL/Real_timer.h>
+
+CGALAPPS_APP (cgal_pca_estimate_normals) (int argc, char** argv)
+{
+  bool verbose;
+  std::string ifilename;
+  std::string ofilename;
+  unsigned int nb_neighbors;
+  bool adaptive;
+  std::string search;
+
+  CGALApps::Args args (verbose, ifilename);
+  args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
+  args.add_option ("neighbors,n", "Number of nearest neighbors used", nb_neighbors, 12);
+  args.add_option ("adaptive,A", "Use per-point neighborhood sizes (scale_k property, see cgal_estimate_scale)"
+                   " bounded by --neighbors", adaptive, false);
+  args.add_option ("search,S", "Neighbor search: [cgal/simd/scalar]", search, "cgal");
+  
+  if(!args.parse(argc, argv))
+  {
+    CGALApps::print_help ("PCA Estimate Normals",
+                          "Estimates the normal vectors of a point set by fitting a plane to the nearest neighbors.", args);
+    std::cout << std::endl
+              << "Neighbor searches:" << std::endl
+              << "  cgal:   CGAL k-d tree (default)" << std::endl
+              << "  simd:   Bucket k-d tree with the widest SIMD kernel of the CPU (AVX-512/AVX2)" << std::endl
+              << "  scalar: Bucket k-d tree with the scalar kernel" << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  CGALApps::Search_method search_method;
+  if (!CGALApps::search_method_from_string (search, search_method))
+  {
+    std::cerr << "Error: unknown neighbor search \"" << search << "\"" << std::endl;
+    return EXIT_FAILURE;
+  }
+  
+  CGAL::Real_timer t;
+  if (verbose)
+  {
+    std::cerr << "[CGALApps] PCA Estimate Normals" << std::endl
+              << " * neighbors = " << nb_neighbors << std::endl
+              << " * adaptive = " << (adaptive ? "yes" : "no") << std::endl
+              << " * search = " << search << std::endl;
+    t.start();
+  }
+
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       std::vector<unsigned int> sizes;
+       if (adaptive && !CGALApps::adaptive_neighborhood_sizes (points, 3, nb_neighbors, sizes))
+       {
+         std::cerr << "Error: point set does not have a scale_k property." << std::endl;
+         return EXIT_FAILURE;
+       }
+
+       CGALApps::Neighbor_graph graph = (adaptive ? CGALApps::Neighbor_graph (points, sizes, search_method)
+                                         : CGALApps::Neighbor_graph (points, nb_neighbors, search_method));
+       if (verbose)
+         graph.print_statistics (std::cerr);
+
+       CGALApps::pca_estimate_normals (points, graph);
+
+       CGALApps::write_point_set (ofilename, points);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
+}
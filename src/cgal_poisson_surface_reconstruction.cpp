@@ -1,6 +1,11 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
+
+#include "poisson_reconstruction.h"
 
 #include <CGAL/Surface_mesh_default_triangulation_3.h>
 #include <CGAL/make_surface_mesh.h>
@@ -10,7 +15,7 @@
 #include <CGAL/property_map.h>
 #include <CGAL/Real_timer.h>
 
-int main (int argc, char** argv)
+CGALAPPS_APP (cgal_poisson_surface_reconstruction) (int argc, char** argv)
 {
   bool verbose;
   double epsilon;
@@ -20,6 +25,12 @@ int main (int argc, char** argv)
   double sm_angle;
   double sm_radius;
   double sm_distance;
+  double tile_size;
+  double margin;
+  bool polyhedron;
+  std::string solver_type;
+  double tolerance;
+  std::string warm_start;
 
   CGALApps::Args args (verbose, ifilename);
   args.add_option ("output,o", "Output file in OFF format", ofilename, "", "stdout");
@@ -27,17 +38,32 @@ int main (int argc, char** argv)
   args.add_option ("angle,a", "Bound of minimum facet angle in degrees", sm_angle, 20.0);
   args.add_option ("radius,r", "Bound of radius of Delaunay balls w.r.t. spacing", sm_radius, 30.0);
   args.add_option ("distance,d", "Bound of center-center distances w.r.t. spacing", sm_distance, 0.375);
+  args.add_option ("polyhedron,P", "Build a polyhedron before writing the output (slower, uses more memory)",
+                   polyhedron, false);
+
+  args.add_section ("Solver");
+  args.add_option ("solver,S", "Linear solver: cg (conjugate gradient), ichol (conjugate gradient with incomplete Cholesky preconditioner) or ldlt (sparse Cholesky)",
+                   solver_type, "cg");
+  args.add_option ("tolerance,T", "Relative tolerance of iterative solvers", tolerance, -1., "Eigen default");
+  args.add_option ("warm-start,W", "File storing the solution, interpolated as initial guess of the next run", warm_start,
+                   "", "none");
+
+  args.add_section ("Tiling");
+  args.add_option ("tile-size,t", "Solve and mesh cubic tiles of this size in parallel, by marching tetrahedra of step spacing (angle, radius and distance are not used)",
+                   tile_size, 0., "no tiling");
+  args.add_option ("margin,M", "Overlap between tiles w.r.t. spacing (at most the tile size)", margin, 10.);
 
   if(!args.parse(argc, argv))
   {
-    std::cout << "-----------------------------------------" << std::endl
-              << "[CGALApps] Poisson Surface Reconstruction" << std::endl
-              << "-----------------------------------------" << std::endl << std::endl
-              << "Reconstructs a surface based on an implicit function whose gradient fit the input normal vectors."
-              << std::endl << args.help();
+    CGALApps::print_help ("Poisson Surface Reconstruction",
+                          "Reconstructs a surface based on an implicit function whose gradient fit the input normal vectors.", args);
     return EXIT_SUCCESS;
   }
 
+  // Solvers and tiles check cancellation, not CGAL's polyhedron pipeline
+  if (!polyhedron)
+    CGALApps::install_cancellation_handler();
+
   CGAL::Real_timer t;
   if (verbose)
   {
@@ -45,48 +71,142 @@ int main (int argc, char** argv)
               << " * spacing = " << spacing << std::endl
               << " * angle = " << sm_angle << std::endl
               << " * radius = " << sm_radius << std::endl
-              << " * distance = " << sm_distance << std::endl;
+              << " * distance = " << sm_distance << std::endl
+              << " * tile-size = " << tile_size << std::endl
+              << " * margin = " << margin << std::endl
+              << " * polyhedron = " << (polyhedron ? "true" : "false") << std::endl
+              << " * solver = " << solver_type << std::endl
+              << " * tolerance = " << tolerance << std::endl
+              << " * warm-start = " << warm_start << std::endl;
     t.start();
   }
-  
-  Point_set points;
 
-  CGALApps::read_point_set (ifilename, points);
-    
-  if (points.empty())
+  CGALApps::Poisson_solver::Type type;
+  if (!CGALApps::Poisson_solver::type_from_string (solver_type, type))
   {
-    std::cerr << "Error: zero points read." << std::endl;
+    std::cerr << "Error: unknown solver " << solver_type << "." << std::endl;
     return EXIT_FAILURE;
   }
 
-  if (!(points.has_normal_map()))
+  if (warm_start != "" && tile_size > 0.)
   {
-    std::cerr << "Error: point set does not have normal vectors." << std::endl;
+    std::cerr << "Error: tiling does not support warm start." << std::endl;
     return EXIT_FAILURE;
   }
 
-  Polyhedron mesh;
+  if (tile_size > 0. && margin * spacing > tile_size)
+  {
+    std::cerr << "Error: margin should not be wider than a tile." << std::endl;
+    return EXIT_FAILURE;
+  }
 
-  if (!(CGAL::poisson_surface_reconstruction_delaunay
-        (points.begin(), points.end(),
-         points.point_map(), points.normal_map(),
-         mesh, spacing, sm_angle, sm_radius, sm_distance)))
+  if (polyhedron && tile_size > 0.)
   {
-    std::cerr << "Error: reconstruction failed." << std::endl;
+    std::cerr << "Error: tiling does not support polyhedron output." << std::endl;
     return EXIT_FAILURE;
   }
 
-  if (verbose)
-    std::cerr << mesh.size_of_facets() << " facet(s) created." << std::endl;
-  
-  CGALApps::write_surface (ofilename, mesh);
-  
-  if (verbose)
+  if (polyhedron && (type != CGALApps::Poisson_solver::CG || tolerance > 0. || warm_start != ""))
   {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
+    std::cerr << "Error: solver options are not available with polyhedron output." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (warm_start != "" && args.batch() != "")
+  {
+    std::cerr << "Error: batch processing does not support warm start." << std::endl;
+    return EXIT_FAILURE;
   }
-  
-  return EXIT_SUCCESS;
+
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".off",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       CGALApps::Poisson_solver solver (type, tolerance);
+       CGALApps::Poisson_solver_statistics statistics;
+       solver.set_statistics (&statistics);
+
+       CGALApps::Poisson_solution previous;
+       if (warm_start != "")
+       {
+         if (!CGALApps::read_poisson_solution (warm_start, previous) && verbose)
+           std::cerr << "No valid previous solution found in " << warm_start << "." << std::endl;
+         solver.set_warm_start (&previous);
+       }
+
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       if (!(points.has_normal_map()))
+       {
+         std::cerr << "Error: point set does not have normal vectors." << std::endl;
+         return EXIT_FAILURE;
+       }
+
+       if (!polyhedron)
+       {
+         CGALApps::Triangle_soup soup;
+         bool success;
+         if (tile_size > 0.)
+           success = CGALApps::tiled_poisson_reconstruction (points, tile_size, margin * spacing, spacing,
+                                                             soup, solver, verbose, &statistics);
+         else
+           success = CGALApps::poisson_reconstruction (points.begin(), points.end(),
+                                                       points.point_map(), points.normal_map(),
+                                                       spacing, sm_angle, sm_radius, sm_distance,
+                                                       soup, solver);
+         if (!success)
+         {
+           std::cerr << "Error: reconstruction failed." << std::endl;
+           return EXIT_FAILURE;
+         }
+
+         if (verbose)
+           std::cerr << statistics.solves << " linear system(s) solved in " << statistics.time << " second(s) ("
+                     << statistics.iterations << " iteration(s), "
+                     << statistics.warm_starts << " warm start(s), max relative residual "
+                     << statistics.residual << ")" << std::endl
+                     << soup.facets.size() << " facet(s) created." << std::endl;
+
+         if (warm_start != "" && !CGALApps::write_poisson_solution (warm_start, previous))
+           std::cerr << "Warning: cannot write solution to " << warm_start << "." << std::endl;
+
+         CGALApps::write_surface (ofilename, soup.points, soup.facets);
+
+         cache.store (ofilename);
+
+         CGALApps::print_done (verbose, t);
+
+         return EXIT_SUCCESS;
+       }
+
+       Polyhedron mesh;
+
+       if (!(CGAL::poisson_surface_reconstruction_delaunay
+             (points.begin(), points.end(),
+              points.point_map(), points.normal_map(),
+              mesh, spacing, sm_angle, sm_radius, sm_distance)))
+       {
+         std::cerr << "Error: reconstruction failed." << std::endl;
+         return EXIT_FAILURE;
+       }
+
+       if (verbose)
+         std::cerr << mesh.size_of_facets() << " facet(s) created." << std::endl;
+
+       CGALApps::write_surface (ofilename, mesh);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
 }
 
@@ -1,64 +1,110 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
+#include "point_stream.h"
+#include "random.h"
+
+#include "random_simplify_point_set.h"
 
-#include <CGAL/random_simplify_point_set.h>
 #include <CGAL/Real_timer.h>
 
-int main (int argc, char** argv)
+CGALAPPS_APP (cgal_random_simplify_point_set) (int argc, char** argv)
 {
   bool verbose;
   std::string ifilename;
   std::string ofilename;
   double percent;
+  std::uint64_t seed;
+  bool stream;
   
   CGALApps::Args args (verbose, ifilename);
   args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
   args.add_option ("percent,p", "Removed percentage", percent, 50);
+  args.add_option ("seed,s", "Seed of the random sampling (same seed, same output)", seed, 0);
+  args.add_option ("stream", "Overlap reading, sampling and writing (XYZ input, output file): "
+                   "each point is removed with probability percent/100", stream, false);
 
   if(!args.parse(argc, argv))
   {
-    std::cout << "----------------------------------" << std::endl
-              << "[CGALApps] Random Simplify Point Set" << std::endl
-              << "----------------------------------" << std::endl << std::endl
-              << "Simplifies a point set randomly."
-              << std::endl << args.help();
+    CGALApps::print_help ("Random Simplify Point Set",
+                          "Simplifies a point set randomly.", args);
     return EXIT_SUCCESS;
   }
 
+  // Streamed reading stops on cancellation
+  if (stream && args.cache_dir() == "")
+    CGALApps::install_cancellation_handler();
+
   CGAL::Real_timer t;
   if (verbose)
   {
     std::cerr << "[CGALApps] Random Simplify Point Set" << std::endl
-              << " * percent = " << percent << std::endl;
+              << " * percent = " << percent << std::endl
+              << " * seed = " << seed << std::endl;
     t.start();
   }
   
-  Point_set points;
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       CGALApps::Result_cache cache (args, verbose);
 
-  CGALApps::read_point_set (ifilename, points);
-    
-  if (points.empty())
-  {
-    std::cerr << "Error: zero points read." << std::endl;
-    return EXIT_FAILURE;
-  }
-  
-  points.remove (CGAL::random_simplify_point_set (points, percent), points.end());
+       if (stream && !cache.enabled()
+           && CGALApps::can_stream_xyz_points (ifilename, ofilename, CGALApps::PLY_BINARY_STREAM))
+       {
+         // Points removed by the in-memory sampling are the ones with
+         // the lowest keys: keys below the percentile are removed
+         // instead, so that the points do not have to be sorted
+         const double threshold = percent / 100.;
+         CGALApps::Stream_statistics statistics
+           = CGALApps::stream_xyz_points (ifilename, ofilename, CGALApps::PLY_BINARY_STREAM,
+                                          [&](std::size_t i) -> bool
+                                          {
+                                            return CGALApps::counter_random_uniform (seed, i) >= threshold;
+                                          });
+         if (statistics.nb_read == 0)
+         {
+           std::cerr << "Error: zero points read." << std::endl;
+           return EXIT_FAILURE;
+         }
 
-  if (verbose)
-    std::cerr << 100. * points.garbage_size() / (points.size() + points.garbage_size())
-              << "% / " << points.garbage_size() << " point(s) removed ("
-              << points.size() << " point(s) remaining)." << std::endl;
+         std::size_t nb_removed = statistics.nb_read - statistics.nb_written;
+         if (verbose)
+           std::cerr << 100. * nb_removed / statistics.nb_read
+                     << "% / " << nb_removed << " point(s) removed ("
+                     << statistics.nb_written << " point(s) remaining)." << std::endl;
 
-  CGALApps::write_point_set (ofilename, points);
+         CGALApps::print_done (verbose, t);
 
-  if (verbose)
-  {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
-  }
+         return EXIT_SUCCESS;
+       }
+
+       Point_set points;
+
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       points.remove (CGALApps::random_simplify_point_set (points, percent, seed), points.end());
+
+       if (verbose)
+         std::cerr << 100. * points.garbage_size() / (points.size() + points.garbage_size())
+                   << "% / " << points.garbage_size() << " point(s) removed ("
+                   << points.size() << " point(s) remaining)." << std::endl;
+
+       CGALApps::write_point_set (ofilename, points);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
 
-  return EXIT_SUCCESS;
+       return EXIT_SUCCESS;
+     });
 }
 
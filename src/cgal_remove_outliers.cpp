@@ -1,11 +1,17 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+#include "cache.h"
+#include "point_stream.h"
+
+#include "remove_outliers.h"
 
 #include <CGAL/remove_outliers.h>
 #include <CGAL/Real_timer.h>
 
-int main (int argc, char** argv)
+CGALAPPS_APP (cgal_remove_outliers) (int argc, char** argv)
 {
   bool verbose;
   std::string ifilename;
@@ -13,64 +19,114 @@ int main (int argc, char** argv)
   unsigned int nb_neighbors;
   double percent;
   double distance;
+  std::string search;
+  bool adaptive;
+  bool stream;
 
   CGALApps::Args args (verbose, ifilename);
   args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
   args.add_option ("neighbors,n", "Number of nearest neighbors used", nb_neighbors, 6);
   args.add_option ("percent,p", "Percentage threshold", percent, 100);
   args.add_option ("distance,d", "Distance threshold", distance, 0.1);
+  args.add_option ("adaptive,A", "Use per-point neighborhood sizes (scale_k property, see cgal_estimate_scale)"
+                   " bounded by --neighbors", adaptive, false);
+  args.add_option ("search,S", "Neighbor search: [cgal/simd/scalar]", search, "cgal");
+  args.add_option ("stream", "Parse the input while reading it and format the output while writing it (XYZ input)",
+                   stream, false);
 
   if(!args.parse(argc, argv))
   {
-    std::cout << "----------------------------------" << std::endl
-              << "[CGALApps] Remove Outliers" << std::endl
-              << "----------------------------------" << std::endl << std::endl
-              << "Removes the outliers of a point set based on the local average squared distance."
-              << std::endl << args.help();
+    CGALApps::print_help ("Remove Outliers",
+                          "Removes the outliers of a point set based on the local average squared distance.", args);
+    std::cout << std::endl
+              << "Neighbor searches:" << std::endl
+              << "  cgal:   CGAL k-d tree (default)" << std::endl
+              << "  simd:   Bucket k-d tree with the widest SIMD kernel of the CPU (AVX-512/AVX2)" << std::endl
+              << "  scalar: Bucket k-d tree with the scalar kernel" << std::endl;
       
     return EXIT_SUCCESS;
   }
 
+  CGALApps::Search_method search_method;
+  if (!CGALApps::search_method_from_string (search, search_method))
+  {
+    std::cerr << "Error: unknown neighbor search \"" << search << "\"" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Streamed reading stops on cancellation
+  if (stream && args.cache_dir() == "")
+    CGALApps::install_cancellation_handler();
+
   CGAL::Real_timer t;
   if (verbose)
   {
     std::cerr << "[CGALApps] Remove Outliers" << std::endl
               << " * neighbors = " << nb_neighbors << std::endl
               << " * percent = " << percent << std::endl
-              << " * distance = " << distance << std::endl;
+              << " * distance = " << distance << std::endl
+              << " * adaptive = " << (adaptive ? "yes" : "no") << std::endl
+              << " * search = " << search << std::endl;
     t.start();
   }
 
-  Point_set points;
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
 
-  CGALApps::read_point_set (ifilename, points);
-    
-  if (points.empty())
-  {
-    std::cerr << "Error: zero points read." << std::endl;
-    return EXIT_FAILURE;
-  }
+       // Scores need the neighbors of each point: only reading and
+       // writing are pipelined
+       CGALApps::Result_cache cache (args, verbose);
+       bool pipelined = (stream && !cache.enabled() && CGALApps::extension_of_file_is (ifilename, "xyz"));
+       if (pipelined)
+         CGALApps::read_xyz_point_set_pipelined (ifilename, points);
+       else if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
 
-  points.remove_from
-    (CGAL::remove_outliers
-     (points, nb_neighbors,
-      CGAL::parameters::point_map (points.point_map())
-      .threshold_percent(percent)
-      .threshold_distance(distance)));
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
 
-  if (verbose)
-    std::cerr << 100. * points.garbage_size() / (points.size() + points.garbage_size())
-              << "% / " << points.garbage_size() << " point(s) removed ("
-              << points.size() << " point(s) remaining)." << std::endl;
+       std::vector<unsigned int> sizes;
+       if (adaptive && !CGALApps::adaptive_neighborhood_sizes (points, 2, nb_neighbors, sizes))
+       {
+         std::cerr << "Error: point set does not have a scale_k property." << std::endl;
+         return EXIT_FAILURE;
+       }
 
-  CGALApps::write_point_set (ofilename, points);
-  
-  if (verbose)
-  {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
-  }
+       // CGAL's version only takes a global number of neighbors
+       if (search_method == CGALApps::KD_TREE && !adaptive)
+         points.remove_from
+           (CGAL::remove_outliers
+            (points, nb_neighbors,
+             CGAL::parameters::point_map (points.point_map())
+             .threshold_percent(percent)
+             .threshold_distance(distance)));
+       else
+       {
+         CGALApps::Neighbor_graph graph = (adaptive ? CGALApps::Neighbor_graph (points, sizes, search_method)
+                                           : CGALApps::Neighbor_graph (points, nb_neighbors, search_method));
+         if (verbose)
+           graph.print_statistics (std::cerr);
+         points.remove_from (CGALApps::remove_outliers (points, graph, percent, distance));
+       }
+
+       if (verbose)
+         std::cerr << 100. * points.garbage_size() / (points.size() + points.garbage_size())
+                   << "% / " << points.garbage_size() << " point(s) removed ("
+                   << points.size() << " point(s) remaining)." << std::endl;
+
+       if (pipelined)
+         CGALApps::write_point_set_pipelined (ofilename, points);
+       else
+         CGALApps::write_point_set (ofilename, points);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
 
-  return EXIT_SUCCESS;
+       return EXIT_SUCCESS;
+     });
 }
 
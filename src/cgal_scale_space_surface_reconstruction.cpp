@@ -1,6 +1,10 @@
 #include "Args.h"
+#include "app.h"
 #include "types.h"
 #include "io.h"
+#include "batch.h"
+
+#include "parallel.h"
 
 #include <CGAL/Scale_space_surface_reconstruction_3.h>
 #include <CGAL/Scale_space_reconstruction_3/Advancing_front_mesher.h>
@@ -9,13 +13,18 @@
 #include <CGAL/Scale_space_reconstruction_3/Weighted_PCA_smoother.h>
 #include <CGAL/Real_timer.h>
 
+#include <boost/filesystem.hpp>
+
+#include <set>
+#include <sstream>
+
 typedef CGAL::Scale_space_surface_reconstruction_3<Kernel> Scale_space;
 typedef CGAL::Scale_space_reconstruction_3::Advancing_front_mesher<Kernel> Advancing_front_mesher;
 typedef CGAL::Scale_space_reconstruction_3::Alpha_shape_mesher<Kernel> Alpha_shape_mesher;
 typedef CGAL::Scale_space_reconstruction_3::Jet_smoother<Kernel> Jet_smoother;
 typedef CGAL::Scale_space_reconstruction_3::Weighted_PCA_smoother<Kernel> Weighted_PCA_smoother;
 
-int main (int argc, char** argv)
+CGALAPPS_APP (cgal_scale_space_surface_reconstruction) (int argc, char** argv)
 {
   bool verbose;
   std::string ifilename;
@@ -33,6 +42,8 @@ int main (int argc, char** argv)
   double radius;
   double beta;
   double length;
+  std::string snapshots;
+  std::string snapshot_dir;
   
   CGALApps::Args args (verbose, ifilename);
   args.add_option ("output,o", "Output file in OFF format", ofilename, "", "stdout");
@@ -58,105 +69,205 @@ int main (int argc, char** argv)
   args.add_option ("manifold,M", "Force manifold output", force_manifold, false);
   args.add_option ("angle,A", "Maximum angle between two facets for manifold output", angle, 45);
 
+  args.add_section ("Snapshots");
+  args.add_option ("snapshots,k", "Scales to reconstruct, e.g. \"1,2,4\" or \"all\"", snapshots, "", "last scale");
+  args.add_option ("snapshot-dir,D", "Directory where smoothed point sets are saved", snapshot_dir, "", "none");
+
   if(!args.parse(argc, argv))
   {
-    std::cout << "-------------------------------------------------" << std::endl
-              << "[CGALApps] Scale Space Surface Reconstruction" << std::endl
-              << "-------------------------------------------------" << std::endl << std::endl
-              << "Reconstructs an interpolating surface based on the a smoothed version on the point set."
-              << std::endl << args.help();
+    CGALApps::print_help ("Scale Space Surface Reconstruction",
+                          "Reconstructs an interpolating surface based on the a smoothed version on the point set.", args);
+    std::cout << std::endl
+              << "When several scales are reconstructed, they are meshed in parallel and the scale"
+              << std::endl << "number is appended to the output name (`out.off` -> `out_scale2.off`)."
+              << std::endl;
     return EXIT_SUCCESS;
   }
 
 
-  CGAL::Real_timer t;
-  if (verbose)
+  if (smoother != "pca" && smoother != "jet")
   {
-    std::cerr << "[CGALApps] Scale Space Surface Reconstruction" << std::endl
-              << " * scales = " << scales << std::endl;
-    t.start();
+    std::cerr << "Error: unknown smoother \"" << smoother << "\"" << std::endl;
+    return EXIT_FAILURE;
   }
-  
-  Point_set points;
-
-  CGALApps::read_point_set (ifilename, points);
-    
-  if (points.empty())
+  if (mesher != "alpha" && mesher != "advancing")
   {
-    std::cerr << "Error: zero points read." << std::endl;
+    std::cerr << "Error: unknown mesher \"" << mesher << "\"" << std::endl;
     return EXIT_FAILURE;
   }
 
-  Scale_space scale_space (points.points().begin(), points.points().end());
-
-  if (smoother == "pca")
-  {
-
-    if (verbose)
-      std::cerr << "Using weighted PCA smoother:" << std::endl
-                << " * neighbors = " << neighbors << std::endl
-                << " * samples = " << samples << std::endl;
-
-    Weighted_PCA_smoother smoother (neighbors, samples);
-    scale_space.increase_scale (scales, smoother);
-  }
-  else if (smoother == "jet")
-  {
-    if (verbose)
-      std::cerr << "Using jet smoother:" << std::endl
-                << " * neighbors = " << neighbors << std::endl
-                << " * fitting = " << fitting << std::endl
-                << " * monge = " << monge << std::endl;
-    
-    Jet_smoother smoother (neighbors, fitting, monge);
-    scale_space.increase_scale (scales, smoother);
-  }
+  // Scales to reconstruct
+  std::set<unsigned int> selected;
+  if (snapshots == "")
+    selected.insert (scales);
+  else if (snapshots == "all")
+    for (unsigned int s = 1; s <= scales; ++ s)
+      selected.insert (s);
   else
   {
-    std::cerr << "Error: unknown smoother \"" << smoother << "\"" << std::endl;
-    return EXIT_FAILURE;
+    std::istringstream iss (snapshots);
+    std::string token;
+    while (std::getline (iss, token, ','))
+    {
+      int s = std::atoi (token.c_str());
+      if (s < 1 || s > int(scales))
+      {
+        std::cerr << "Error: scale " << token << " out of range [1;" << scales << "]" << std::endl;
+        return EXIT_FAILURE;
+      }
+      selected.insert ((unsigned int)(s));
+    }
   }
 
-  if (mesher == "alpha")
+  if (args.cache_dir() != "")
   {
-    if (verbose)
-      std::cerr << "Using alpha shape mesher:" << std::endl
-                << " * radius = " << radius << std::endl
-                << " * force_manifold = " << (force_manifold ? "yes" : "no") << std::endl
-                << " * angle = " << angle << std::endl;
-    
-    Alpha_shape_mesher mesher (radius, false, force_manifold, angle);
-    scale_space.reconstruct_surface (mesher);
+    std::cerr << "Error: results of this app cannot be cached (several outputs)." << std::endl;
+    return EXIT_FAILURE;
   }
-  else if (mesher == "advancing")
+
+  if (snapshot_dir != "" && args.batch() != "")
   {
-    if (verbose)
-      std::cerr << "Using advancing front mesher:" << std::endl
-                << " * radius = " << radius << std::endl
-                << " * beta = " << beta << std::endl
-                << " * length = " << length << std::endl;
-    
-    Advancing_front_mesher mesher (length, radius, beta);
-    scale_space.reconstruct_surface (mesher);
+    std::cerr << "Error: batch processing does not support snapshot directory." << std::endl;
+    return EXIT_FAILURE;
   }
-  else
+
+  if (selected.size() > 1 && ofilename == "" && args.batch() == "")
   {
-    std::cerr << "Error: unknown mesher \"" << mesher << "\"" << std::endl;
+    std::cerr << "Error: an output file is needed to reconstruct several scales." << std::endl;
     return EXIT_FAILURE;
   }
-  
-  if (verbose)
-    std::cerr << scale_space.number_of_facets() << " facet(s) created." << std::endl;
-  
-  CGALApps::write_surface (ofilename, points, CGAL::make_range (scale_space.facets_begin(),
-                                                                scale_space.facets_end()));
 
+  CGAL::Real_timer t;
   if (verbose)
   {
-    t.stop();
-    std::cerr << "Done in " << t.time() << " second(s)." << std::endl;
+    std::cerr << "[CGALApps] Scale Space Surface Reconstruction" << std::endl
+              << " * scales = " << scales << std::endl
+              << " * snapshots =";
+    for (unsigned int s : selected)
+      std::cerr << " " << s;
+    std::cerr << std::endl;
+    t.start();
   }
   
-  return EXIT_SUCCESS;
-}
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".off",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::read_point_set (ifilename, points);
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       if (snapshot_dir != "")
+         boost::filesystem::create_directories (snapshot_dir);
+
+       // Smoothing is incremental: each scale is one more iteration of the
+       // smoother, and the smoothed points of the selected scales are kept
+       Scale_space scale_space (points.points().begin(), points.points().end());
+       std::vector<unsigned int> snapshot_scales;
+       std::vector<std::vector<Point_3> > snapshot_points;
 
+       Weighted_PCA_smoother pca_smoother (neighbors, samples);
+       Jet_smoother jet_smoother (neighbors, fitting, monge);
+
+       if (verbose)
+       {
+         if (smoother == "pca")
+           std::cerr << "Using weighted PCA smoother:" << std::endl
+                     << " * neighbors = " << neighbors << std::endl
+                     << " * samples = " << samples << std::endl;
+         else
+           std::cerr << "Using jet smoother:" << std::endl
+                     << " * neighbors = " << neighbors << std::endl
+                     << " * fitting = " << fitting << std::endl
+                     << " * monge = " << monge << std::endl;
+       }
+
+       for (unsigned int s = 1; s <= scales; ++ s)
+       {
+         if (smoother == "pca")
+           scale_space.increase_scale (1, pca_smoother);
+         else
+           scale_space.increase_scale (1, jet_smoother);
+
+         if (snapshot_dir != "")
+         {
+           Point_set snapshot;
+           snapshot.reserve (points.size());
+           for (Scale_space::Point_const_iterator it = scale_space.points_begin();
+                it != scale_space.points_end(); ++ it)
+             snapshot.insert (*it);
+           std::ostringstream oss;
+           oss << snapshot_dir << "/scale" << s << ".ply";
+           CGALApps::write_point_set (oss.str(), snapshot);
+         }
+
+         if (selected.find (s) != selected.end())
+         {
+           snapshot_scales.push_back (s);
+           snapshot_points.push_back (std::vector<Point_3> (scale_space.points_begin(), scale_space.points_end()));
+         }
+       }
+
+       if (verbose)
+       {
+         if (mesher == "alpha")
+           std::cerr << "Using alpha shape mesher:" << std::endl
+                     << " * alpha = " << alpha << std::endl
+                     << " * force_manifold = " << (force_manifold ? "yes" : "no") << std::endl
+                     << " * angle = " << angle << std::endl;
+         else
+           std::cerr << "Using advancing front mesher:" << std::endl
+                     << " * radius = " << radius << std::endl
+                     << " * beta = " << beta << std::endl
+                     << " * length = " << length << std::endl;
+       }
+
+       // Snapshots are independent and meshed in parallel. Facets refer to
+       // the point indices, so they are written with the input points.
+       CGALApps::parallel_for
+         (0, snapshot_scales.size(),
+          [&](std::size_t i)
+          {
+            Scale_space snapshot_space (snapshot_points[i].begin(), snapshot_points[i].end());
+            if (mesher == "alpha")
+            {
+              Alpha_shape_mesher alpha_mesher (alpha, false, force_manifold, angle);
+              snapshot_space.reconstruct_surface (alpha_mesher);
+            }
+            else
+            {
+              Advancing_front_mesher advancing_mesher (length, radius, beta);
+              snapshot_space.reconstruct_surface (advancing_mesher);
+            }
+            std::vector<Point_3>().swap (snapshot_points[i]);
+
+            std::string filename = ofilename;
+            if (snapshot_scales.size() > 1)
+            {
+              boost::filesystem::path path (ofilename);
+              std::ostringstream oss;
+              oss << (path.parent_path() / path.stem()).string() << "_scale" << snapshot_scales[i]
+                  << path.extension().string();
+              filename = oss.str();
+            }
+
+            if (verbose)
+            {
+              std::ostringstream oss;
+              oss << "Scale " << snapshot_scales[i] << ": " << snapshot_space.number_of_facets()
+                  << " facet(s) created." << std::endl;
+              std::cerr << oss.str();
+            }
+
+            CGALApps::write_surface (filename, points, CGAL::make_range (snapshot_space.facets_begin(),
+                                                                         snapshot_space.facets_end()));
+          });
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
+}
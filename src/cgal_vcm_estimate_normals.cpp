@@ -0,0 +1,79 @@
+#include "Args.h"
+#include "app.h"
+#include "types.h"
+#include "io.h"
+#include "batch.h"
+#include "cache.h"
+
+#include "covariance.h"
+#include "parallel.h"
+
+#include <CGAL/vcm_estimate_normals.h>
+#include <CGAL/Real_timer.h>
+
+CGALAPPS_APP (cgal_vcm_estimate_normals) (int argc, char** argv)
+{
+  bool verbose;
+  std::string ifilename;
+  std::string ofilename;
+  double offset;
+  double convolution;
+
+  CGALApps::Args args (verbose, ifilename);
+  args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
+  args.add_option ("offset,R", "Offset radius", offset, 0.2);
+  args.add_option ("convolution,r", "Convolution radius", convolution, 0.1);
+  
+  if(!args.parse(argc, argv))
+  {
+    CGALApps::print_help ("VCM Estimate Normals",
+                          "Estimates the normal vectors of a point set based on its Voronoi Covariance Measure.", args);
+    return EXIT_SUCCESS;
+  }
+  
+  CGAL::Real_timer t;
+  if (verbose)
+  {
+    std::cerr << "[CGALApps] VCM Estimate Normals" << std::endl
+              << " * offset = " << offset << std::endl
+              << " * convolution = " << convolution << std::endl;
+    t.start();
+  }
+
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       std::vector<CGAL::cpp11::array<double, 6> > vcm;
+       CGAL::compute_vcm (points, vcm, offset, convolution,
+                          CGAL::parameters::point_map (points.point_map()));
+
+       // The normal is the eigenvector of the largest eigenvalue of the VCM
+       points.add_normal_map();
+       CGALApps::parallel_for
+         (0, points.size(),
+          [&](std::size_t i)
+          {
+            double values[3], vectors[9];
+            CGALApps::symmetric_eigen_3 (vcm[i].data(), values, vectors);
+            points.normal(*(points.begin() + i)) = Vector_3 (vectors[6], vectors[7], vectors[8]);
+          });
+
+       CGALApps::write_point_set (ofilename, points);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
+}
@@ -0,0 +1,122 @@
+#include "Args.h"
+#include "app.h"
+#include "types.h"
+#include "io.h"
+#include "batch.h"
+#include "cache.h"
+
+#include "tiling.h"
+
+#include <CGAL/wlop_simplify_and_regularize_point_set.h>
+#include <CGAL/Real_timer.h>
+
+CGALAPPS_APP (cgal_wlop_simplify_and_regularize_point_set) (int argc, char** argv)
+{
+  bool verbose;
+  std::string ifilename;
+  std::string ofilename;
+  double percent;
+  double radius;
+  unsigned int iterations;
+  bool uniform;
+  double tile_size;
+
+  CGALApps::Args args (verbose, ifilename);
+  args.add_option ("output,o", "Output file in PLY format", ofilename, "", "stdout");
+  args.add_option ("percent,p", "Percentage of points to retain", percent, 5.);
+  args.add_option ("radius,r", "Neighbor radius", radius, -1., "8 times the average spacing");
+  args.add_option ("iterations,n", "Number of iterations", iterations, 35);
+  args.add_option ("uniform,u", "Require uniform sampling", uniform, false);
+  args.add_option ("tile-size,t", "Process cubic tiles of this size one at a time", tile_size, 0., "no tiling");
+
+  if(!args.parse(argc, argv))
+  {
+    CGALApps::print_help ("WLOP Simplify and Regularize Point Set",
+                          "Simplifies and regularizes a point set using the weighted locally optimal\n"
+                          "projection (WLOP) algorithm.", args);
+    return EXIT_SUCCESS;
+  }
+
+  CGAL::Real_timer t;
+  if (verbose)
+  {
+    std::cerr << "[CGALApps] WLOP Simplify and Regularize Point Set" << std::endl
+              << " * percent = " << percent << std::endl
+              << " * radius = " << radius << std::endl
+              << " * iterations = " << iterations << std::endl
+              << " * uniform = " << (uniform ? "yes" : "no") << std::endl
+              << " * tile-size = " << tile_size << std::endl;
+    t.start();
+  }
+
+  return CGALApps::process_files
+    (args, verbose, ifilename, ofilename, ".ply",
+     [&](const std::string& ifilename, const std::string& ofilename) -> int
+     {
+       Point_set points;
+
+       CGALApps::Result_cache cache (args, verbose);
+       if (cache.read_point_set (ifilename, points, ofilename))
+         return EXIT_SUCCESS;
+
+       if (CGALApps::empty_input (points))
+         return EXIT_FAILURE;
+
+       std::vector<Point_3> output;
+
+       if (tile_size > 0.)
+       {
+         // Tiles are processed one at a time so that the all-pairs-in-radius
+         // cost and the memory stay bounded by the tile size. Each tile uses
+         // the points within a margin around it as context and only keeps
+         // the output points lying inside it.
+         std::vector<CGALApps::Tile> tiles;
+         CGALApps::compute_tiles (points, tile_size, (radius > 0. ? 2. * radius : 0.1 * tile_size), tiles);
+
+         if (verbose)
+           std::cerr << tiles.size() << " tile(s) used." << std::endl;
+
+         for (std::size_t i = 0; i < tiles.size(); ++ i)
+         {
+           std::vector<Point_3> tile_output;
+           CGAL::wlop_simplify_and_regularize_point_set<Concurrency_tag>
+             (tiles[i].points, std::back_inserter (tile_output),
+              CGAL::parameters::point_map (points.point_map())
+              .select_percentage (percent)
+              .neighbor_radius (radius)
+              .number_of_iterations (iterations)
+              .require_uniform_sampling (uniform));
+
+           for (const Point_3& p : tile_output)
+             if (tiles[i].contains (p))
+               output.push_back (p);
+
+           std::vector<typename Point_set::Index>().swap (tiles[i].points);
+         }
+       }
+       else
+         CGAL::wlop_simplify_and_regularize_point_set<Concurrency_tag>
+           (points, std::back_inserter (output),
+            CGAL::parameters::point_map (points.point_map())
+            .select_percentage (percent)
+            .neighbor_radius (radius)
+            .number_of_iterations (iterations)
+            .require_uniform_sampling (uniform));
+
+       if (verbose)
+         std::cerr << output.size() << " point(s) created." << std::endl;
+
+       Point_set simplified;
+       simplified.reserve (output.size());
+       for (const Point_3& p : output)
+         simplified.insert (p);
+
+       CGALApps::write_point_set (ofilename, simplified);
+
+       cache.store (ofilename);
+
+       CGALApps::print_done (verbose, t);
+
+       return EXIT_SUCCESS;
+     });
+}
@@ -0,0 +1,43 @@
+#include "app.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Multi-call binary: all apps are linked in and registered by
+// CGALAPPS_APP. The app is chosen by the name the binary is called
+// with (cgal_* symlinks to cgalapps) or by the first argument.
+int main (int argc, char** argv)
+{
+  std::string name (argv[0]);
+  name = name.substr (name.find_last_of ('/') + 1);
+
+  if (const CGALApps::App* app = CGALApps::find_app (name))
+    return app->main (argc, argv);
+
+  if (argc > 1)
+  {
+    if (const CGALApps::App* app = CGALApps::find_app (argv[1]))
+    {
+      // The app sees its full name, as if called through its symlink
+      // (same cache entries)
+      argv[1] = const_cast<char*>(app->name);
+      return app->main (argc - 1, argv + 1);
+    }
+  }
+
+  bool help = (argc == 1 || std::strcmp (argv[1], "-h") == 0 || std::strcmp (argv[1], "--help") == 0);
+  if (!help)
+    std::cerr << "Error: unknown app " << argv[1] << "." << std::endl;
+
+  std::ostream& out = (help ? std::cout : std::cerr);
+  out << "---------------" << std::endl
+      << "[CGALApps] Apps" << std::endl
+      << "---------------" << std::endl << std::endl
+      << "Usage: " << name << " <app> [options], or through a symlink named after the app." << std::endl
+      << "The `cgal_` prefix of app names is optional. Available apps:" << std::endl;
+  for (const std::string& app : CGALApps::app_names())
+    out << "  " << app << std::endl;
+
+  return (help ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,600 @@
+#include "Args.h"
+#include "app.h"
+#include "types.h"
+#include "io.h"
+
+#include "neighbor_search.h"
+#include "parallel.h"
+#include "pca_estimate_normals.h"
+#include "random_simplify_point_set.h"
+
+#include <CGAL/grid_simplify_point_set.h>
+#include <CGAL/Real_timer.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+
+  // Point set kept in memory with its k-d tree, built on first use and
+  // dropped when the points change
+  struct Named_point_set
+  {
+    Point_set points;
+    std::unique_ptr<CGALApps::Neighbor_query> index;
+
+    const CGALApps::Neighbor_query& neighbor_query()
+    {
+      if (!index)
+        index.reset (new CGALApps::Neighbor_query (points));
+      return *index;
+    }
+
+    void changed()
+    {
+      points.collect_garbage();
+      index.reset();
+    }
+  };
+
+  typedef std::map<std::string, std::shared_ptr<Named_point_set> > Registry;
+
+  // "<command> <arguments...> [key=value...] [-> <target>]"
+  struct Request
+  {
+    std::string command;
+    std::vector<std::string> arguments;
+    std::map<std::string, std::string> parameters;
+    std::string target;
+
+    double parameter (const std::string& key, double default_value) const
+    {
+      std::map<std::string, std::string>::const_iterator found = parameters.find (key);
+      if (found == parameters.end())
+        return default_value;
+      return std::atof (found->second.c_str());
+    }
+  };
+
+  bool parse_request (const std::string& line, Request& request)
+  {
+    std::istringstream iss (line);
+    if (!(iss >> request.command))
+      return false;
+
+    std::string token;
+    while (iss >> token)
+    {
+      if (token == "->")
+      {
+        if (!(iss >> request.target))
+          return false;
+      }
+      else if (token.find ('=') != std::string::npos)
+        request.parameters[token.substr (0, token.find ('='))] = token.substr (token.find ('=') + 1);
+      else
+        request.arguments.push_back (token);
+    }
+    return true;
+  }
+
+  // Shared memory layout: number of points and flags (1 if normals are
+  // present) as 64-bit unsigned integers, then x/y/z of all points as
+  // doubles, then x/y/z of all normals. The client unlinks the object.
+  bool export_to_shared_memory (const Point_set& points, const std::string& name, std::size_t& bytes)
+  {
+    const std::size_t size = points.size();
+    const bool normals = points.has_normal_map();
+    bytes = 2 * sizeof(std::uint64_t) + size * (normals ? 6 : 3) * sizeof(double);
+
+    int fd = shm_open (name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+      return false;
+    if (ftruncate (fd, off_t(bytes)) != 0)
+    {
+      close (fd);
+      shm_unlink (name.c_str());
+      return false;
+    }
+    void* data = mmap (nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+    if (data == MAP_FAILED)
+    {
+      shm_unlink (name.c_str());
+      return false;
+    }
+
+    std::uint64_t* header = static_cast<std::uint64_t*>(data);
+    header[0] = size;
+    header[1] = (normals ? 1 : 0);
+    double* coords = reinterpret_cast<double*>(header + 2);
+
+    CGALApps::parallel_for
+      (0, size,
+       [&](std::size_t i)
+       {
+         typename Point_set::Index idx = *(points.begin() + i);
+         const Point_3& p = points.point(idx);
+         coords[3 * i] = p.x();
+         coords[3 * i + 1] = p.y();
+         coords[3 * i + 2] = p.z();
+         if (normals)
+         {
+           const Vector_3& n = points.normal(idx);
+           coords[3 * (size + i)] = n.x();
+           coords[3 * (size + i) + 1] = n.y();
+           coords[3 * (size + i) + 2] = n.z();
+         }
+       });
+
+    munmap (data, bytes);
+    return true;
+  }
+
+  // Resolves filename relative to root (symbolic links and `..`
+  // included) and fails if the result is not inside root
+  bool path_in_root (const boost::filesystem::path& root, const std::string& filename, std::string& path)
+  {
+    boost::filesystem::path file (filename);
+    if (!file.is_absolute())
+      file = root / file;
+
+    boost::system::error_code error;
+    boost::filesystem::path resolved = boost::filesystem::weakly_canonical (file, error);
+    if (error)
+      return false;
+
+    boost::filesystem::path::const_iterator r = root.begin(), p = resolved.begin();
+    for (; r != root.end(); ++ r, ++ p)
+      if (p == resolved.end() || *p != *r)
+        return false;
+
+    path = resolved.string();
+    return true;
+  }
+
+  class Server
+  {
+    Registry m_sets;
+    std::mutex m_mutex;
+    std::size_t m_nb_exports;
+    boost::filesystem::path m_root;
+    bool m_verbose;
+
+  public:
+
+    std::atomic<bool> running;
+
+    // Files of load and save requests are restricted to root (canonical)
+    Server (const boost::filesystem::path& root, bool verbose)
+      : m_nb_exports (0), m_root (root), m_verbose (verbose), running (true) { }
+
+    bool load (const std::string& name, const std::string& filename)
+    {
+      std::shared_ptr<Named_point_set> set (new Named_point_set);
+      CGALApps::read_point_set (filename, set->points, false);
+      if (set->points.empty())
+        return false;
+      m_sets[name] = set;
+      return true;
+    }
+
+    // Runs one request and returns the reply line
+    std::string process (const std::string& line)
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+
+      CGAL::Real_timer t;
+      t.start();
+
+      Request request;
+      std::string reply;
+      if (!parse_request (line, request))
+        reply = "ERROR malformed request";
+      else
+        reply = run (request);
+
+      if (m_verbose)
+        std::cerr << "[" << t.time() * 1000. << " ms] " << line << " => " << reply << std::endl;
+
+      return reply;
+    }
+
+  private:
+
+    std::shared_ptr<Named_point_set> find (const std::string& name)
+    {
+      Registry::iterator found = m_sets.find (name);
+      if (found == m_sets.end())
+        return std::shared_ptr<Named_point_set>();
+      return found->second;
+    }
+
+    // Point set modified by an operation: the source itself, or a copy
+    // registered under the target name
+    std::shared_ptr<Named_point_set> output_of (const Request& request, const std::shared_ptr<Named_point_set>& source)
+    {
+      if (request.target == "" || request.target == request.arguments[0])
+        return source;
+      std::shared_ptr<Named_point_set> target (new Named_point_set);
+      target->points = source->points;
+      m_sets[request.target] = target;
+      return target;
+    }
+
+    std::string run (const Request& request)
+    {
+      std::ostringstream reply;
+      reply.precision (std::numeric_limits<double>::digits10 + 2);
+
+      if (request.command == "list")
+      {
+        reply << "OK";
+        for (const Registry::value_type& set : m_sets)
+          reply << " " << set.first << ":" << set.second->points.size();
+        return reply.str();
+      }
+
+      if (request.command == "shutdown")
+      {
+        running = false;
+        return "OK";
+      }
+
+      if (request.arguments.empty())
+        return "ERROR missing point set name";
+      const std::string& name = request.arguments[0];
+
+      if (request.command == "load")
+      {
+        if (request.arguments.size() != 2)
+          return "ERROR usage: load <set> <file>";
+        std::string path;
+        if (!path_in_root (m_root, request.arguments[1], path))
+          return "ERROR file outside of root directory " + request.arguments[1];
+        if (!load (name, path))
+          return "ERROR cannot read " + request.arguments[1];
+        reply << "OK " << m_sets[name]->points.size();
+        return reply.str();
+      }
+
+      std::shared_ptr<Named_point_set> set = find (name);
+      if (!set)
+        return "ERROR unknown point set " + name;
+
+      if (request.command == "save")
+      {
+        if (request.arguments.size() != 2)
+          return "ERROR usage: save <set> <file>";
+        std::string path;
+        if (!path_in_root (m_root, request.arguments[1], path))
+          return "ERROR file outside of root directory " + request.arguments[1];
+        CGALApps::write_point_set (path, set->points);
+        return "OK";
+      }
+
+      if (request.command == "drop")
+      {
+        m_sets.erase (name);
+        return "OK";
+      }
+
+      if (request.command == "export")
+      {
+        std::ostringstream oss;
+        oss << "/cgald-" << getpid() << "-" << m_nb_exports ++;
+        std::size_t bytes;
+        if (!export_to_shared_memory (set->points, oss.str(), bytes))
+          return "ERROR cannot create shared memory";
+        reply << "OK " << oss.str() << " " << bytes;
+        return reply.str();
+      }
+
+      if (request.command == "knn")
+      {
+        if (request.arguments.size() != 4)
+          return "ERROR usage: knn <set> x y z [k=<k>]";
+        Point_3 query (std::atof (request.arguments[1].c_str()),
+                       std::atof (request.arguments[2].c_str()),
+                       std::atof (request.arguments[3].c_str()));
+
+        std::vector<typename Point_set::Index> neighbors;
+        set->neighbor_query().k_neighbors (query, (unsigned int)(request.parameter ("k", 6)),
+                                           std::back_inserter (neighbors));
+        reply << "OK";
+        for (typename Point_set::Index idx : neighbors)
+          reply << " " << std::size_t(idx);
+        return reply.str();
+      }
+
+      if (request.command == "average_spacing")
+      {
+        // Same definition as CGAL::compute_average_spacing(), using the
+        // resident k-d tree
+        const unsigned int k = (unsigned int)(request.parameter ("k", 6));
+        const CGALApps::Neighbor_query& query = set->neighbor_query();
+        std::vector<double> spacing (set->points.size(), 0.);
+        CGALApps::parallel_for
+          (0, set->points.size(),
+           [&](std::size_t i)
+           {
+             const Point_3& p = set->points.point(*(set->points.begin() + i));
+             std::vector<typename Point_set::Index> neighbors;
+             neighbors.reserve (k + 1);
+             query.k_neighbors (p, k + 1, std::back_inserter (neighbors));
+             for (std::size_t j = 1; j < neighbors.size(); ++ j)
+               spacing[i] += std::sqrt (CGAL::squared_distance (p, set->points.point(neighbors[j])));
+             if (neighbors.size() > 1)
+               spacing[i] /= (neighbors.size() - 1);
+           });
+        double sum = 0.;
+        for (double s : spacing)
+          sum += s;
+        reply << "OK " << sum / set->points.size();
+        return reply.str();
+      }
+
+      std::shared_ptr<Named_point_set> output;
+
+      if (request.command == "grid_simplify")
+      {
+        output = output_of (request, set);
+        output->points.remove (CGAL::grid_simplify_point_set (output->points, request.parameter ("eps", 0.1)),
+                               output->points.end());
+      }
+      else if (request.command == "random_simplify")
+      {
+        output = output_of (request, set);
+        output->points.remove (CGALApps::random_simplify_point_set (output->points, request.parameter ("percent", 50.),
+                                                                    std::uint64_t(request.parameter ("seed", 0))),
+                               output->points.end());
+      }
+      else if (request.command == "pca_estimate_normals")
+      {
+        output = output_of (request, set);
+        CGALApps::pca_estimate_normals (output->points,
+                                        CGALApps::Neighbor_graph (output->points,
+                                                                  (unsigned int)(request.parameter ("k", 12))));
+      }
+      else
+        return "ERROR unknown command " + request.command;
+
+      output->changed();
+      reply << "OK " << output->points.size();
+      return reply.str();
+    }
+  };
+
+  std::string socket_path;
+
+  void stop (int)
+  {
+    unlink (socket_path.c_str());
+    _exit (EXIT_SUCCESS);
+  }
+
+  // Connection served by its own thread. The socket is closed once
+  // the thread is joined, so that shutdown() can always be called on it.
+  struct Client
+  {
+    int socket;
+    std::atomic<bool> done;
+    std::thread thread;
+
+    Client (int socket) : socket (socket), done (false) { }
+  };
+
+  void serve_client (Server& server, Client& client, int listener)
+  {
+    std::string buffer;
+    char chunk[4096];
+    ssize_t nb_read;
+    while ((nb_read = read (client.socket, chunk, sizeof(chunk))) > 0)
+    {
+      buffer.append (chunk, std::size_t(nb_read));
+      std::size_t end;
+      while ((end = buffer.find ('\n')) != std::string::npos)
+      {
+        std::string reply = server.process (buffer.substr (0, end)) + "\n";
+        buffer.erase (0, end + 1);
+        if (send (client.socket, reply.data(), reply.size(), MSG_NOSIGNAL) < 0)
+        {
+          client.done = true;
+          return;
+        }
+        if (!server.running)
+        {
+          // Unblocks accept() in the main thread
+          shutdown (listener, SHUT_RDWR);
+          client.done = true;
+          return;
+        }
+      }
+    }
+    client.done = true;
+  }
+
+  // Joins the threads of clients (all of them, or only the ones done)
+  // and closes their sockets
+  void join_clients (std::list<Client>& clients, bool all)
+  {
+    for (std::list<Client>::iterator it = clients.begin(); it != clients.end(); )
+      if (all || it->done)
+      {
+        it->thread.join();
+        close (it->socket);
+        it = clients.erase (it);
+      }
+      else
+        ++ it;
+  }
+
+  // Removes a stale socket file left by a previous daemon, but neither
+  // another file nor the socket of a running daemon
+  bool remove_stale_socket (const sockaddr_un& address)
+  {
+    struct stat status;
+    if (lstat (address.sun_path, &status) != 0)
+      return (errno == ENOENT);
+    if (!S_ISSOCK (status.st_mode))
+      return false;
+
+    int probe = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0)
+      return false;
+    bool alive = (connect (probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+    close (probe);
+    return !alive && unlink (address.sun_path) == 0;
+  }
+
+} // namespace
+
+CGALAPPS_APP (cgald) (int argc, char** argv)
+{
+  bool verbose;
+  std::string ifilename;
+
+  std::string root;
+
+  CGALApps::Args args (verbose, ifilename, false);
+  args.add_option ("socket,s", "Path of the Unix domain socket (only accessible to the user)", socket_path,
+                   "/tmp/cgald.sock");
+  args.add_option ("root,R", "Directory that files of load and save requests are restricted to", root,
+                   ".", "current directory");
+
+  if(!args.parse(argc, argv))
+  {
+    CGALApps::print_help ("Daemon",
+                          "Keeps named point sets (and their search trees) in memory and runs operations\n"
+                          "on them, requested line by line over a Unix domain socket.", args);
+    std::cout << std::endl
+              << "Requests (replies are one line starting with OK or ERROR):" << std::endl
+              << "  load <set> <file>                         Read a file of the root directory (replies size)" << std::endl
+              << "  save <set> <file>                         Write a PLY file in the root directory" << std::endl
+              << "  drop <set>                                Free a point set" << std::endl
+              << "  list                                      List point sets and their sizes" << std::endl
+              << "  export <set>                              Copy to shared memory (replies name and bytes)" << std::endl
+              << "  knn <set> x y z [k=6]                     Indices of nearest neighbors" << std::endl
+              << "  average_spacing <set> [k=6]               Average spacing" << std::endl
+              << "  grid_simplify <set> [eps=0.1] [-> <out>]" << std::endl
+              << "  random_simplify <set> [percent=50] [seed=0] [-> <out>]" << std::endl
+              << "  pca_estimate_normals <set> [k=12] [-> <out>]" << std::endl
+              << "  shutdown                                  Stop the daemon" << std::endl
+              << "Operations modify the point set in place unless an output set is given." << std::endl
+              << "Exported shared memory objects hold the number of points and a flag (1 if" << std::endl
+              << "normals) as uint64, then all points and all normals as double x/y/z; the" << std::endl
+              << "client unmaps and unlinks them." << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (verbose)
+    std::cerr << "[CGALApps] Daemon" << std::endl
+              << " * socket = " << socket_path << std::endl
+              << " * root = " << root << std::endl;
+
+  boost::system::error_code error;
+  boost::filesystem::path root_path = boost::filesystem::canonical (root, error);
+  if (error || !boost::filesystem::is_directory (root_path))
+  {
+    std::cerr << "Error: root " << root << " is not a directory." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Server server (root_path, verbose);
+
+  if (ifilename != "")
+  {
+    std::string name = boost::filesystem::path(ifilename).stem().string();
+    if (!server.load (name, ifilename))
+    {
+      std::cerr << "Error: zero points read." << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (verbose)
+      std::cerr << "Point set " << name << " loaded." << std::endl;
+  }
+
+  sockaddr_un address;
+  if (socket_path.size() >= sizeof(address.sun_path))
+  {
+    std::cerr << "Error: socket path too long." << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::memset (&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy (address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+  if (!remove_stale_socket (address))
+  {
+    std::cerr << "Error: " << socket_path << " exists and is not a stale socket." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Requests read and write files with the permissions of the daemon:
+  // the socket is created without group and other permissions
+  int listener = socket (AF_UNIX, SOCK_STREAM, 0);
+  mode_t mask = umask (0077);
+  bool bound = (listener >= 0 && bind (listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+  umask (mask);
+  if (!bound
+      || chmod (socket_path.c_str(), 0600) != 0
+      || listen (listener, 16) != 0)
+  {
+    std::cerr << "Error: cannot listen on " << socket_path << "." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  signal (SIGINT, stop);
+  signal (SIGTERM, stop);
+
+  if (verbose)
+    std::cerr << "Listening on " << socket_path << "." << std::endl;
+
+  // One thread per client, requests are run one at a time (operations
+  // are parallel themselves)
+  std::list<Client> clients;
+  while (server.running)
+  {
+    int fd = accept (listener, nullptr, nullptr);
+    if (fd < 0)
+      break;
+    join_clients (clients, false);
+    clients.emplace_back (fd);
+    Client& client = clients.back();
+    client.thread = std::thread (serve_client, std::ref (server), std::ref (client), listener);
+  }
+
+  close (listener);
+  unlink (socket_path.c_str());
+
+  // Unblocks the reads of connected clients before joining them
+  for (Client& client : clients)
+    shutdown (client.socket, SHUT_RDWR);
+  join_clients (clients, true);
+
+  if (verbose)
+    std::cerr << "Done." << std::endl;
+
+  return EXIT_SUCCESS;
+}